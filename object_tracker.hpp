@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+
+// An object found in one sweep. A run of neighbouring angle bins with similar
+// range. Angles are in degrees, distances in mm. An object across the 0/360 deg
+// seam has an end bin and angle below its start.
+class SonarObject {
+public:
+
+    int id = 0;
+    int start_bin = 0, end_bin = 0;
+    float start_angle = 0, end_angle = 0;
+
+    int nearest_mm = 0;
+    int centroid_bin = 0;
+    int centroid_mm = 0;
+
+    // Range at the first and last bin, and how many readings made the object.
+    int start_mm = 0, end_mm = 0;
+    int num_readings = 0;
+
+    // Change per sweep since the object was last seen, 0 for new objects.
+    int range_rate_mm = 0;
+    int bearing_rate_bins = 0;
+
+    // Number of sweeps this object has been matched across.
+    int sweeps_seen = 1;
+
+    // True if both objects would draw the same outline on the display.
+    bool same_outline(SonarObject &other) {
+        return (start_bin == other.start_bin) && (end_bin == other.end_bin)
+            && (nearest_mm == other.nearest_mm);
+    }
+
+    void print() {
+        printf("OBJ %d: %.1f-%.1f deg, nearest %d mm, centroid %d mm, vel %d mm %d bins, seen %d\n",
+            id, start_angle, end_angle, nearest_mm, centroid_mm,
+            range_rate_mm, bearing_rate_bins, sweeps_seen);
+    }
+};
+
+
+// Groups filtered readings into objects as they arrive, and matches them against
+// the objects from the sweep before to track them. Each reading only touches the
+// segment currently being built. The matching runs once per sweep over a handful
+// of objects, so the cost per reading stays constant.
+class ObjectTracker {
+public:
+
+    ObjectTracker(int num_bins, int max_bin_gap=2, int max_range_jump_mm=150)
+        : _num_bins(num_bins), _max_bin_gap(max_bin_gap), _max_range_jump(max_range_jump_mm) {}
+
+    // Add the filtered distance for a bin, 0 if there is no target.
+    // Returns true when a sweep has just finished and objects/prev_objects were updated.
+    bool add_reading(int bin, uint16_t distance_mm) {
+        bool sweep_finished = false;
+
+        if (bin <= last_bin) {
+            _close_segment();
+            _finish_sweep();
+            sweep_finished = true;
+        }
+
+        if (distance_mm == 0) {
+            _close_segment();
+        } else if (segment_open && _continues_segment(bin, distance_mm)) {
+            _extend_segment(bin, distance_mm);
+        } else {
+            _close_segment();
+            _open_segment(bin, distance_mm);
+        }
+
+        last_bin = bin;
+        return sweep_finished;
+    }
+
+    // Print every object from the last finished sweep over usb.
+    void print_objects() {
+        printf("OBJECTS %d\n", num_objects);
+        for (int i = 0; i < num_objects; i++) {
+            objects[i].print();
+        }
+    }
+
+    bool _continues_segment(int bin, int distance_mm) {
+        int jump = distance_mm - seg_last_mm;
+        if (jump < 0) jump = -jump;
+        return ((bin - seg_end_bin) <= _max_bin_gap) && (jump <= _max_range_jump);
+    }
+
+    void _open_segment(int bin, int distance_mm) {
+        segment_open = true;
+        seg_start_bin = bin;
+        seg_end_bin = bin;
+        seg_first_mm = distance_mm;
+        seg_last_mm = distance_mm;
+        seg_nearest_mm = distance_mm;
+        seg_sum_bins = bin;
+        seg_sum_mm = distance_mm;
+        seg_count = 1;
+    }
+
+    void _extend_segment(int bin, int distance_mm) {
+        seg_end_bin = bin;
+        seg_last_mm = distance_mm;
+        if (distance_mm < seg_nearest_mm) seg_nearest_mm = distance_mm;
+        seg_sum_bins += bin;
+        seg_sum_mm += distance_mm;
+        seg_count++;
+    }
+
+    // Turn the open segment into an object for this sweep.
+    // Segments past the object limit are dropped.
+    void _close_segment() {
+        if (!segment_open) return;
+        segment_open = false;
+
+        if (num_building >= max_objects) return;
+
+        SonarObject &obj = building[num_building];
+        obj = SonarObject();
+        obj.start_bin = seg_start_bin;
+        obj.end_bin = seg_end_bin;
+        obj.start_angle = (seg_start_bin * 360.0f) / _num_bins;
+        obj.end_angle = ((seg_end_bin + 1) * 360.0f) / _num_bins;
+        obj.nearest_mm = seg_nearest_mm;
+        obj.centroid_bin = seg_sum_bins / seg_count;
+        obj.centroid_mm = seg_sum_mm / seg_count;
+        obj.start_mm = seg_first_mm;
+        obj.end_mm = seg_last_mm;
+        obj.num_readings = seg_count;
+        num_building++;
+    }
+
+    // The sweep is cut at 0 deg, so an object across the seam is closed as two.
+    // Join the last object of the sweep onto the first when they meet up.
+    void _merge_seam() {
+        if (num_building < 2) return;
+
+        SonarObject &first = building[0];
+        SonarObject &last = building[num_building - 1];
+
+        int gap = first.start_bin + _num_bins - last.end_bin;
+        int jump = first.start_mm - last.end_mm;
+        if (jump < 0) jump = -jump;
+        if ((gap > _max_bin_gap) || (jump > _max_range_jump)) return;
+
+        // weight the centroids by readings, with the first object's bins unwrapped past the seam
+        int total = first.num_readings + last.num_readings;
+        int centroid_bin = (last.centroid_bin * last.num_readings
+            + (first.centroid_bin + _num_bins) * first.num_readings) / total;
+
+        first.centroid_mm = (last.centroid_mm * last.num_readings
+            + first.centroid_mm * first.num_readings) / total;
+        first.centroid_bin = centroid_bin % _num_bins;
+        if (last.nearest_mm < first.nearest_mm) first.nearest_mm = last.nearest_mm;
+        first.start_bin = last.start_bin;
+        first.start_angle = last.start_angle;
+        first.start_mm = last.start_mm;
+        first.num_readings = total;
+
+        num_building--;
+    }
+
+    // Signed distance from one bin to another the short way round the circle.
+    int _bin_offset(int from_bin, int to_bin) {
+        int offset = to_bin - from_bin;
+        if (offset > _num_bins / 2) offset -= _num_bins;
+        if (offset < -_num_bins / 2) offset += _num_bins;
+        return offset;
+    }
+
+    // Match the objects built this sweep to the ones from the last sweep by
+    // nearest centroid, carry ids over and estimate velocity, then publish them.
+    void _finish_sweep() {
+        bool taken[max_objects] = {false};
+
+        _merge_seam();
+
+        for (int i = 0; i < num_building; i++) {
+            SonarObject &obj = building[i];
+            int best = -1;
+            int best_cost = 0;
+
+            for (int j = 0; j < num_objects; j++) {
+                if (taken[j]) continue;
+                int d_bins = _bin_offset(objects[j].centroid_bin, obj.centroid_bin);
+                int d_mm = obj.centroid_mm - objects[j].centroid_mm;
+                if (d_bins < 0) d_bins = -d_bins;
+                if (d_mm < 0) d_mm = -d_mm;
+                if ((d_bins > _max_match_bins) || (d_mm > _max_match_mm)) continue;
+
+                // weigh a bin about the same as the range jump allowed between bins
+                int cost = d_bins * _max_range_jump + d_mm;
+                if ((best < 0) || (cost < best_cost)) {
+                    best = j;
+                    best_cost = cost;
+                }
+            }
+
+            if (best >= 0) {
+                taken[best] = true;
+                obj.id = objects[best].id;
+                obj.range_rate_mm = obj.centroid_mm - objects[best].centroid_mm;
+                obj.bearing_rate_bins = _bin_offset(objects[best].centroid_bin, obj.centroid_bin);
+                obj.sweeps_seen = objects[best].sweeps_seen + 1;
+            } else {
+                obj.id = next_id++;
+            }
+        }
+
+        for (int i = 0; i < num_objects; i++) {
+            prev_objects[i] = objects[i];
+        }
+        num_prev_objects = num_objects;
+
+        for (int i = 0; i < num_building; i++) {
+            objects[i] = building[i];
+        }
+        num_objects = num_building;
+        num_building = 0;
+    }
+
+
+    static const int max_objects = 16;
+
+    // Objects from the last finished sweep, and the sweep before that.
+    SonarObject objects[max_objects];
+    int num_objects = 0;
+    SonarObject prev_objects[max_objects];
+    int num_prev_objects = 0;
+
+    // Objects closed so far in the sweep in progress.
+    SonarObject building[max_objects];
+    int num_building = 0;
+
+    // The segment being grown from the latest readings.
+    bool segment_open = false;
+    int seg_start_bin = 0, seg_end_bin = 0;
+    int seg_first_mm = 0, seg_last_mm = 0, seg_nearest_mm = 0;
+    int seg_sum_bins = 0, seg_sum_mm = 0, seg_count = 0;
+
+    int last_bin = -1;
+    int next_id = 1;
+
+    int _num_bins;
+    // Bins with a reading can be this far apart and still be one object,
+    // motor steps are a little wider than a bin so some bins are always empty.
+    int _max_bin_gap;
+    int _max_range_jump;
+    // How far an object's centroid can move between sweeps and still match.
+    int _max_match_bins = 6;
+    int _max_match_mm = 400;
+};
@@ -7,7 +7,12 @@
 #include "US_100.hpp"
 #include "stepper.hpp"
 #include "tft_driver.hpp"
+#include "object_tracker.hpp"
 #include "sonar_display.hpp"
+#include "reading_filter.hpp"
+#include "text_display.hpp"
+#include "screen_snapshot.hpp"
+#include "power_manager.hpp"
 
 
 
@@ -45,7 +50,8 @@ int main()
     tft.write_pixel(red_color, 159 - 2, 119 - 2, 5);
     puts("starting us100");
 
-    auto sonar_disp = SonarDisplay(tft, tft.width, tft.height);
+    // static, the point log and wipe buffer are too big for the stack
+    static SonarDisplay sonar_disp(tft, tft.width, tft.height);
     puts("running plot test");
 
     int test_dist = 1500;
@@ -57,24 +63,72 @@ int main()
 
     tft.fill_screen(60, 60, 60);
     tft.write_pixel(red_color, 159 - 2, 119 - 2, 5);
+    sonar_disp.point_log.clear_log();
+
+    static ReadingFilter reading_filter(sonar_disp._max_distance);
+    static ObjectTracker object_tracker(reading_filter.num_bins);
+
+    // draw through the display's driver so its window count covers everything,
+    // static to keep the glyph cache off the stack
+    static SonarHud hud(sonar_disp);
+    hud.label_ring(sonar_disp, 1000);
+    hud.label_ring(sonar_disp, 2000);
+
+    // send 's' over usb to stream what is on the screen, see tools/snap2img.py
+    static ScreenSnapshot snapshot(sonar_disp._tft);
+
+    // Slow down and blank everything but the plot when the scene stops changing.
+    auto power = PowerManager();
+    // The refreshed columns take in the plot and the HUD, which sits in its corners.
+    int plot_radius_px = sonar_disp.plot_radius_px();
+    PowerControl power_control(sonar_disp._tft, uart, 9600,
+        sonar_disp.center_x - plot_radius_px - 2, sonar_disp.center_x + plot_radius_px + 2);
+
+    uint32_t last_loop_ms = to_ms_since_boot(get_absolute_time());
+    uint32_t last_windows = sonar_disp._tft.windows_opened;
 
     while (1) {
         puts("ping sensor");
         us_100.ping();
-        sonar_disp.clear_3_within(degrees);
         sleep_ms(15);
 
         uint16_t distance_read = us_100.read_distance();
         printf("found distance %d mm, degrees: %f \n", distance_read, degrees);
 
-        if (distance_read < 3000) {
-            // change above to handle distances correctly
-            sonar_disp.plot_reading(distance_read, degrees);
+        // Only touch the screen when the filtered distance for this angle moves,
+        // the old point in the reading's bin is wiped as part of the redraw.
+        FilteredReading reading = reading_filter.add_sample(distance_read, degrees);
+        if (reading.changed) {
+            sonar_disp.replace_reading(reading.distance, degrees, reading.bin);
+        }
+
+        bool sweep_finished = object_tracker.add_reading(reading.bin, reading.distance);
+        if (sweep_finished) {
+            sonar_disp.redraw_object_outlines(
+                object_tracker.prev_objects, object_tracker.num_prev_objects,
+                object_tracker.objects, object_tracker.num_objects);
+            object_tracker.print_objects();
+        }
+
+        power_control.set_mode(power.update(reading.changed, reading.early_change, sweep_finished));
+
+        hud.repair_labels(sonar_disp);
+
+        uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+        uint32_t windows = sonar_disp._tft.windows_opened;
+        hud.update(degrees, reading.distance, now_ms - last_loop_ms, windows - last_windows);
+        last_loop_ms = now_ms;
+        last_windows = sonar_disp._tft.windows_opened;
+
+        if (getchar_timeout_us(0) == 's') {
+            snapshot.start(0, 0, tft.width, tft.height);
         }
+        snapshot.poll();
 
         puts("move motor..");
 
         motor.full_step(10);
+        sleep_ms(power.step_delay_ms());
         degrees += deg_per_step;
         if (degrees > 360) degrees = 0;
 
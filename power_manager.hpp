@@ -0,0 +1,135 @@
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+#include "hardware/spi.h"
+#include "hardware/clocks.h"
+
+
+enum PowerMode {
+    POWER_ACTIVE,   // full scan rate and clock, full frame refresh
+    POWER_IDLE,     // slower scan and clock, panel only refreshes the plot area
+    POWER_SLEEP     // as idle, with the panel asleep
+};
+
+
+// Decides the power mode from scene activity. After idle_after_sweeps sweeps
+// without a filtered change the scan slows down, and after sleep_after_sweeps
+// the panel is put to sleep. A filtered change, or the filter's early hint of
+// one, puts it straight back to active. After an early wake it stays active
+// for the whole next sweep, where the median confirms or refutes the change,
+// and only if that sweep is also quiet does it drop back.
+//
+// While slowed down a step never waits longer than the wake latency, counting
+// the time the panel takes to wake, so a change in front of the sensor is back
+// at full rate within wake_latency_ms.
+class PowerManager {
+public:
+
+    PowerManager(int idle_after_sweeps=3, int sleep_after_sweeps=10, int wake_latency_ms=500, int panel_wake_ms=120)
+        : _idle_after(idle_after_sweeps), _sleep_after(sleep_after_sweeps),
+          _wake_latency(wake_latency_ms), _panel_wake(panel_wake_ms) {}
+
+    // Call once per step with the step's FilteredReading changed and early_change
+    // flags, and whether the step started a new sweep.
+    // Returns the mode to run the next step in.
+    PowerMode update(bool changed, bool early_change, bool sweep_finished) {
+        if (sweep_finished) {
+            // a sweep with an early wake isn't judged, the next one is
+            if (sweep_active) quiet_sweeps = 0;
+            else if (!sweep_woken) quiet_sweeps++;
+
+            if (sweep_woken) mode = POWER_ACTIVE;
+            else if (quiet_sweeps >= _sleep_after) mode = POWER_SLEEP;
+            else if (quiet_sweeps >= _idle_after) mode = POWER_IDLE;
+            else mode = POWER_ACTIVE;
+
+            sweep_active = false;
+            sweep_woken = false;
+        }
+
+        if (changed) {
+            quiet_sweeps = 0;
+            sweep_active = true;
+        }
+        if (early_change) sweep_woken = true;
+        if (changed || early_change) mode = POWER_ACTIVE;
+
+        return mode;
+    }
+
+    // Extra delay to add to each step in the current mode.
+    int step_delay_ms() {
+        int delay = 0;
+        if (mode == POWER_IDLE) delay = _wake_latency;
+        if (mode == POWER_SLEEP) delay = _wake_latency - _panel_wake;
+        return (delay > 0) ? delay : 0;
+    }
+
+
+    PowerMode mode = POWER_ACTIVE;
+    int quiet_sweeps = 0;
+    // A filtered change was seen in the sweep in progress.
+    bool sweep_active = false;
+    // An early hint woke it in the sweep in progress.
+    bool sweep_woken = false;
+
+    int _idle_after;
+    int _sleep_after;
+    int _wake_latency;
+    int _panel_wake;
+};
+
+
+// Applies PowerManager modes to the hardware: system clock, panel partial
+// mode and panel sleep. set_sys_clock_khz moves clk_peri to the 48 MHz usb
+// pll, which caps spi at 24 MHz, so clk_peri is put back on clk_sys after
+// every clock change and the uart and spi baud rates are set again.
+class PowerControl {
+public:
+
+    PowerControl(TFTDriver &tft, uart_inst_t *uart, int uart_baud, int partial_start_row, int partial_end_row)
+        : _tft(tft), _uart(uart), _uart_baud(uart_baud),
+          _partial_start(partial_start_row), _partial_end(partial_end_row) {}
+
+    void set_mode(PowerMode new_mode) {
+        if (new_mode == mode) return;
+        printf("power mode %d -> %d\n", mode, new_mode);
+
+        if (mode == POWER_SLEEP) _tft.sleep_out();
+
+        if (new_mode == POWER_ACTIVE) {
+            _tft.exit_partial();
+            _set_clock(active_khz);
+        } else if (mode == POWER_ACTIVE) {
+            _set_clock(idle_khz);
+            _tft.enter_partial(_partial_start, _partial_end);
+        }
+
+        if (new_mode == POWER_SLEEP) _tft.sleep_in();
+
+        mode = new_mode;
+    }
+
+    void _set_clock(uint32_t khz) {
+        set_sys_clock_khz(khz, true);
+        clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS, khz * 1000, khz * 1000);
+
+        uart_set_baudrate(_uart, _uart_baud);
+        spi_hz = spi_set_baudrate(_tft.spi, _tft.write_mhz * 1000000);
+        printf("clock %d kHz, spi %d Hz\n", (int)khz, (int)spi_hz);
+    }
+
+
+    PowerMode mode = POWER_ACTIVE;
+    // Spi rate the divider actually gives after the last clock change.
+    uint32_t spi_hz = 0;
+
+    uint32_t active_khz = 125000;
+    uint32_t idle_khz = 48000;
+
+    TFTDriver &_tft;
+    uart_inst_t *_uart;
+    int _uart_baud;
+    int _partial_start, _partial_end;
+};
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+
+// Result of feeding one sensor sample through the ReadingFilter.
+// Distances are in mm, 0 means no target in the bin.
+struct FilteredReading {
+    bool changed;
+    // Raw samples disagree with the shown value, in this bin and either the step
+    // before or this bin last sweep. An early hint of a change before the median
+    // catches up, a lone spike or missed echo doesn't set it.
+    bool early_change;
+    int bin;
+    uint16_t distance;
+    uint16_t previous;
+};
+
+
+// Fixed memory noise filter that sits between the US100 and the SonarDisplay.
+// Keeps the last few sweeps of samples for each angle bin, takes the median of
+// them to reject single sweep spikes and glitches, and only reports a change
+// when the median moves more than the change threshold from the last value
+// that was sent to the display. Runs in fixed time per sample with integer math.
+class ReadingFilter {
+public:
+
+    ReadingFilter(int max_distance_mm=3000, int change_threshold_mm=40)
+        : _max_distance(max_distance_mm), _change_threshold(change_threshold_mm) {
+        reset();
+    }
+
+    // Forget all history, every bin goes back to no target.
+    void reset() {
+        for (int b = 0; b < num_bins; b++) {
+            for (int i = 0; i < history_len; i++) {
+                history[b][i] = no_target;
+            }
+            emitted[b] = 0;
+            raw_disagreed[b] = false;
+        }
+        history_ptr = 0;
+        last_bin = -1;
+        last_sample_disagreed = false;
+    }
+
+    // Map a sensor angle in degrees to its bin. Bins are narrower than a motor
+    // step so every step of a sweep lands in a bin of its own.
+    int angle_to_bin(float angle) {
+        int centi_deg = angle * 100;
+        if (centi_deg < 0) centi_deg = 0;
+        int bin = centi_deg * num_bins / 36000;
+        if (bin >= num_bins) bin = num_bins - 1;
+        return bin;
+    }
+
+    // Angle in degrees at the start of a bin.
+    float bin_to_angle(int bin) {
+        return (bin * 360.0f) / num_bins;
+    }
+
+    // Feed a raw distance reading taken at angle. Returns the filtered value for
+    // the bin, and whether it moved enough to be worth redrawing.
+    FilteredReading add_sample(uint16_t distance_mm, float angle) {
+        int bin = angle_to_bin(angle);
+
+        // a new sweep starts when the bins wrap around
+        if (bin <= last_bin) {
+            history_ptr++;
+            if (history_ptr >= history_len) history_ptr = 0;
+        }
+        last_bin = bin;
+
+        // a glitched read repeats the bin's last sample so it can't outvote real ones
+        int prev_ptr = (history_ptr == 0) ? history_len - 1 : history_ptr - 1;
+        bool glitch = _is_glitch(distance_mm);
+        if (glitch) {
+            history[bin][history_ptr] = history[bin][prev_ptr];
+        } else {
+            history[bin][history_ptr] = _reject_spike(distance_mm);
+        }
+
+        uint16_t raw = history[bin][history_ptr];
+        if (raw == no_target) raw = 0;
+
+        uint16_t filtered = _median(history[bin]);
+        if (filtered == no_target) filtered = 0;
+
+        FilteredReading result;
+        result.bin = bin;
+        result.distance = filtered;
+        result.previous = emitted[bin];
+        result.changed = _moved(emitted[bin], filtered);
+
+        bool disagrees = !glitch && _moved(emitted[bin], raw);
+        result.early_change = disagrees && (last_sample_disagreed || raw_disagreed[bin]);
+        if (!glitch) raw_disagreed[bin] = disagrees;
+        last_sample_disagreed = disagrees;
+
+        if (result.changed) emitted[bin] = filtered;
+        else result.distance = emitted[bin];
+
+        return result;
+    }
+
+    // 0 and 0xFFFF come from a dropped or mangled uart byte, not from an echo.
+    bool _is_glitch(uint16_t distance_mm) {
+        return (distance_mm == 0) || (distance_mm == 0xFFFF);
+    }
+
+    // Readings outside the measurable range count as no target.
+    uint16_t _reject_spike(uint16_t distance_mm) {
+        if ((distance_mm < _min_distance) || (distance_mm >= _max_distance)) {
+            return no_target;
+        }
+        return distance_mm;
+    }
+
+    // A target appearing or disappearing is always a change, otherwise
+    // the distance has to move past the threshold.
+    bool _moved(uint16_t last, uint16_t current) {
+        if ((last == 0) || (current == 0)) return last != current;
+
+        int diff = current - last;
+        if (diff < 0) diff = -diff;
+        return diff > _change_threshold;
+    }
+
+    // Median of one bin's history, insertion sort over a fixed small window.
+    uint16_t _median(uint16_t *samples) {
+        uint16_t sorted[history_len];
+
+        for (int i = 0; i < history_len; i++) {
+            uint16_t s = samples[i];
+            int j = i;
+            while ((j > 0) && (sorted[j - 1] > s)) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = s;
+        }
+        return sorted[history_len / 2];
+    }
+
+
+    static const int num_bins = 128;
+    static const int history_len = 3;
+    static const uint16_t no_target = 0xFFFF;
+
+    // Raw samples from the last history_len sweeps, per bin.
+    uint16_t history[num_bins][history_len];
+    // Last value reported as changed for each bin, what the display is showing.
+    uint16_t emitted[num_bins];
+    int history_ptr = 0;
+    int last_bin = -1;
+
+    // Whether the raw sample disagreed with the shown value, per bin for the
+    // last sweep and for the sample just before.
+    bool raw_disagreed[num_bins];
+    bool last_sample_disagreed = false;
+
+    int _max_distance;
+    int _change_threshold;
+    // The US-100 can't measure closer than this, anything below is noise.
+    int _min_distance = 20;
+};
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+
+// Run length encode a row of 3 byte pixels. Each run is written to out as
+// a count byte (1-255) followed by the 3 pixel bytes. out needs room for
+// 4 bytes per pixel in the worst case. Returns the number of bytes written.
+inline int rle_encode_pixels(const uint8_t *pixels, int num_px, uint8_t *out) {
+    int out_len = 0;
+    int i = 0;
+
+    while (i < num_px) {
+        const uint8_t *px = &pixels[i * 3];
+        int run = 1;
+
+        while ((i + run < num_px) && (run < 255)) {
+            const uint8_t *next = &pixels[(i + run) * 3];
+            if ((next[0] != px[0]) || (next[1] != px[1]) || (next[2] != px[2])) break;
+            run++;
+        }
+
+        out[out_len++] = run;
+        out[out_len++] = px[0];
+        out[out_len++] = px[1];
+        out[out_len++] = px[2];
+        i += run;
+    }
+
+    return out_len;
+}
+
+
+// Streams a region of the screen over usb stdio a few rows at a time, so the
+// sonar loop keeps running while a snapshot is taken. Rows are read back from
+// the panel, run length encoded and printed as hex text lines:
+//
+//   SNAP BEGIN <width> <height>
+//   SNAP ROW <y> <hex encoded runs>
+//   SNAP END
+//
+// Text survives the stdio newline translation and can be picked out of the
+// normal debug output. tools/snap2img.py turns a capture into a PPM or PNG.
+class ScreenSnapshot {
+public:
+
+    ScreenSnapshot(TFTDriver &tft, int rows_per_chunk=4) : _tft(tft), _rows_per_chunk(rows_per_chunk) {}
+
+    // Begin streaming a region, restarting if a snapshot is already running.
+    void start(int x, int y, int w, int h) {
+        if (w > max_width) w = max_width;
+        _x = x;
+        _y = y;
+        _w = w;
+        _h = h;
+        next_row = 0;
+        active = true;
+
+        printf("SNAP BEGIN %d %d\n", _w, _h);
+    }
+
+    bool busy() {
+        return active;
+    }
+
+    // Send the next chunk of rows, call once per loop.
+    void poll() {
+        if (!active) return;
+
+        for (int r = 0; (r < _rows_per_chunk) && (next_row < _h); r++) {
+            _send_row(next_row);
+            next_row++;
+        }
+
+        if (next_row >= _h) {
+            puts("SNAP END");
+            active = false;
+        }
+    }
+
+    void _send_row(int row) {
+        _tft.read_block(row_pixels, _x, _y + row, _w, 1);
+        int rle_len = rle_encode_pixels(row_pixels, _w, rle_buff);
+
+        static const char hex_digits[] = "0123456789abcdef";
+        int len = snprintf(line_buff, sizeof(line_buff), "SNAP ROW %d ", row);
+        for (int i = 0; i < rle_len; i++) {
+            line_buff[len++] = hex_digits[rle_buff[i] >> 4];
+            line_buff[len++] = hex_digits[rle_buff[i] & 0xF];
+        }
+        line_buff[len] = 0;
+
+        puts(line_buff);
+    }
+
+
+    static const int max_width = 320;
+
+    TFTDriver &_tft;
+    int _rows_per_chunk;
+    int _x = 0, _y = 0, _w = 0, _h = 0;
+    int next_row = 0;
+    bool active = false;
+
+    uint8_t row_pixels[max_width * 3];
+    uint8_t rle_buff[max_width * 4];
+    char line_buff[32 + max_width * 8];
+};
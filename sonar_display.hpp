@@ -19,8 +19,8 @@ public:
 
 
 // A circular type buffer to record readings on the screen.
-// Holds the reading Point and the reading angle.
-// Used to look up the last readings close to an angle and clear them.
+// Holds the reading Point, the reading angle and the filter bin it was plotted for.
+// Used to look up the last readings close to an angle or in a bin and clear them.
 class ReadingBuffer {
 public:
 
@@ -32,20 +32,29 @@ public:
         clear_log();
     }
 
-    // Clear log by filling the angle reading buffer with -1
+    // Clear log by filling the angle and bin reading buffers with -1
     void clear_log() {
 
         for (int i = 0; i < buff_size; i++) {
             reading_angles[i] = -1;
+            reading_bins[i] = -1;
         }
     }
 
 
-    // Add a reading to the buffer
-    void add_reading(Point point, float angle) {
-        
+    // Add a reading to the buffer. Takes the next free slot, only overwriting
+    // the oldest slot if every one is in use. bin is -1 for readings not plotted
+    // for a filter bin.
+    void add_reading(Point point, float angle, int bin=-1) {
+        for (int i = 0; i < buff_size; i++) {
+            if (reading_angles[buff_ptr] < 0) break;
+            buff_ptr++;
+            if (buff_ptr >= buff_size) buff_ptr = 0;
+        }
+
         reading_points[buff_ptr] = point;
         reading_angles[buff_ptr] = angle;
+        reading_bins[buff_ptr] = bin;
 
         buff_ptr++;
         if (buff_ptr >= buff_size) buff_ptr = 0;
@@ -69,55 +78,40 @@ public:
         return Point(999, 999);
     }
 
-    // Get the first 3 points found within the angle and put them in a buffer.
-    // If less than 3 are found, fill remaining with Point(999,999)
-    void get_x_within(float angle, Point *point_buff, int num_pts) {
-
-        uint8_t points_found = 0;
+    // Move every point plotted for a filter bin into point_buff, removing them
+    // from the log. Returns the number of points.
+    int take_bin(int bin, Point *point_buff, int max_pts) {
+        int points_found = 0;
 
-        for (int i = 0; i < buff_size; i++) {
-            float pt_angle = reading_angles[i];
-            if (_should_erase(pt_angle, angle)) {
+        for (int i = 0; (i < buff_size) && (points_found < max_pts); i++) {
+            if ((reading_angles[i] >= 0) && (reading_bins[i] == bin)) {
                 point_buff[points_found] = reading_points[i];
                 points_found++;
-                if (points_found == num_pts) return;
+                reading_angles[i] = -1;
+                reading_bins[i] = -1;
             }
         }
 
-        for (int i = points_found; i < num_pts; i++) {
-            point_buff[i] = Point(999,999);
-        }
+        return points_found;
     }
 
-    // Determine if the stored point should be erased at the given sensor position.
-    // Handle rollover over 360 deg
-    bool _should_erase(float stored_point_angle, float sensor_position) {
-        float max_erase_angle = sensor_position + _erase_within_deg;
-
-        if ((max_erase_angle) < 360) {
-            return ((stored_point_angle >= sensor_position) && (stored_point_angle <= max_erase_angle));
-        }
-
-        if (stored_point_angle <= 300) {
-            float stored_plus_360 = stored_point_angle + 360;
-            return ((stored_plus_360 >= sensor_position) && (stored_plus_360 <= max_erase_angle));
-        }
-
-        return ((stored_point_angle >= sensor_position) && (stored_point_angle <= max_erase_angle));
-    }
-    
 
     int buff_size = 300;
     int buff_ptr = 0;
     Point reading_points[300];
-    int reading_angles[300];
+    float reading_angles[300];
+    int reading_bins[300];
+
 
-    // Points within this number of degrees are candidates for being erased.
-    int _erase_within_deg = 5;
 
 
+};
 
 
+// A screen rectangle the plot should report writes to, see SonarDisplay::protect_area.
+struct ProtectedArea {
+    int x0, y0, x1, y1;
+    bool damaged;
 };
 
 
@@ -140,6 +134,11 @@ public:
         return map(dist, 30, _max_distance, 10, 120);
     }
 
+    // Radius in pixels of the plot at the maximum distance.
+    int plot_radius_px() {
+        return map_mm_distance_to_px_distance(_max_distance);
+    }
+
     // Change the maximum distance and scaling of the display.
     void set_max_distance(int max_distance_mm) {
         _max_distance = max_distance_mm;
@@ -209,42 +208,162 @@ public:
     
     }
 
-    void plot_reading(int distance, float angle ) {
+    // Plot a reading, bin is the filter bin it belongs to or -1 for none.
+    void plot_reading(int distance, float angle, int bin=-1) {
         int px_dist = map_mm_distance_to_px_distance(distance);
 
         Point p = reading_to_point(px_dist, angle);
 
         p.print();
-        uint8_t px_green[3] = {0, 63 << 2, 0};
+        _write_point(_point_color, p.getx(), p.gety());
+        point_log.add_reading(p, angle, bin);
+    }
+
+    // Swap the point shown for a filtered reading. Wipes whatever is logged for
+    // the reading's bin and plots the new distance, a distance of 0 only wipes.
+    void replace_reading(int distance, float angle, int bin) {
+        wipe_bin(bin);
 
-        _write_point(px_green, p.getx(), p.gety());
-        point_log.add_reading(p, angle);
+        if (distance != 0) {
+            plot_reading(distance, angle, bin);
+        }
     }
 
     // Plot a black circle at the given distance in mm. Useful for showing screen scale.
-    // Will not be erased during operation, only if the screen is cleared.
+    // The circle sits in the plot, so its pixels are kept and redrawn wherever
+    // a wipe erases over them. Circles past max_ring_points aren't repaired.
     void plot_circle_at(int distance_mm) {
         int circle_px_dist = map_mm_distance_to_px_distance(distance_mm);
         int circle_deg = 2;
-        uint8_t col[] = {0, 0, 0};
         Point p;
 
         for (int i = 0; i < 360; i += circle_deg) {
             p = reading_to_point(circle_px_dist, i);
-            _tft.write_pixel(col, p.getx(), p.gety(), 1);
+            _tft.write_pixel(_ring_color, p.getx(), p.gety(), 1);
+            if (num_ring_points < max_ring_points) ring_points[num_ring_points++] = p;
+        }
+
+    }
+
+    // Whether x/y is one of the circles' pixels.
+    bool _on_ring(int x, int y) {
+        for (int i = 0; i < num_ring_points; i++) {
+            if ((ring_points[i]._x == x) && (ring_points[i]._y == y)) return true;
+        }
+        return false;
+    }
+
+    // Redraw the circle pixels that fall inside any of the wiped points.
+    void _repair_rings_over(Point *wiped, int num_wiped) {
+        for (int i = 0; i < num_ring_points; i++) {
+            int x = ring_points[i]._x;
+            int y = ring_points[i]._y;
+
+            for (int w = 0; w < num_wiped; w++) {
+                int x0, y0, x1, y1;
+                _point_bounds(wiped[w], x0, y0, x1, y1);
+                if ((x >= x0) && (x <= x1) && (y >= y0) && (y <= y1)) {
+                    _tft.write_pixel(_ring_color, x, y, 1);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Move object outlines from one sweep's objects to the next. Outlines that
+    // are identical in both are left alone, the rest are erased and redrawn.
+    void redraw_object_outlines(SonarObject *old_objs, int num_old, SonarObject *new_objs, int num_new) {
+        for (int i = 0; i < num_old; i++) {
+            if (!_has_outline(old_objs[i], new_objs, num_new)) {
+                _write_object_outline(_bg_color, old_objs[i]);
+            }
+        }
+        for (int i = 0; i < num_new; i++) {
+            if (!_has_outline(new_objs[i], old_objs, num_old)) {
+                _write_object_outline(_outline_color, new_objs[i]);
+            }
+        }
+    }
+
+    bool _has_outline(SonarObject &obj, SonarObject *objs, int num_objs) {
+        for (int i = 0; i < num_objs; i++) {
+            if (obj.same_outline(objs[i])) return true;
+        }
+        return false;
+    }
+
+    // Draw an arc just inside the nearest range of an object, across its angles.
+    // Kept a few pixels in, and pixels that fall on a logged point or a circle
+    // are skipped, so neither drawing nor erasing it touches them. A target
+    // moving closer can put its new points right on the old outline.
+    void _write_object_outline(uint8_t *color, SonarObject &obj) {
+        int px_dist = map_mm_distance_to_px_distance(obj.nearest_mm) - 4;
+        if (px_dist < 1) return;
+
+        // objects across the seam end at a lower angle than they start
+        float end_angle = obj.end_angle;
+        if (end_angle < obj.start_angle) end_angle += 360;
+
+        Point p;
+        for (float angle = obj.start_angle; angle < end_angle; angle += 1) {
+            float wrapped = (angle >= 360) ? angle - 360 : angle;
+            p = reading_to_point(px_dist, wrapped);
+            if (_on_logged_point(p.getx(), p.gety()) || _on_ring(p.getx(), p.gety())) continue;
+            _tft.write_pixel(color, p.getx(), p.gety(), 1);
+            _check_damage(p.getx(), p.gety(), p.getx(), p.gety());
         }
+    }
+
+    // Whether x/y is inside a point still in the log.
+    bool _on_logged_point(int x, int y) {
+        for (int i = 0; i < point_log.buff_size; i++) {
+            if (point_log.reading_angles[i] < 0) continue;
 
+            int x0, y0, x1, y1;
+            _point_bounds(point_log.reading_points[i], x0, y0, x1, y1);
+            if ((x >= x0) && (x <= x1) && (y >= y0) && (y <= y1)) return true;
+        }
+        return false;
     }
 
     // write a small multi-pixel point centered on x/y
     void _write_point(uint8_t *color, int x, int y) {
 
-        _tft.write_pixel(color, x - 1, y - 1, 3);
+        _tft.write_pixel(color, x - 1, y - 1, _point_px);
+        _check_damage(x - 1, y - 1, x - 2 + _point_px, y - 2 + _point_px);
+    }
+
+    // Keep track of an area drawn by something other than the plot, like a ring
+    // label. Plot writes that land on it mark it damaged so its owner can redraw it.
+    // Returns the area's index, or -1 if there's no room for another.
+    int protect_area(int x, int y, int w, int h) {
+        if (num_protected >= max_protected) return -1;
+
+        ProtectedArea &area = protected_areas[num_protected];
+        area.x0 = x;
+        area.y0 = y;
+        area.x1 = x + w - 1;
+        area.y1 = y + h - 1;
+        area.damaged = false;
+        return num_protected++;
+    }
+
+    // Mark protected areas overlapping the rectangle x0/y0 to x1/y1 as damaged.
+    void _check_damage(int x0, int y0, int x1, int y1) {
+        for (int i = 0; i < num_protected; i++) {
+            ProtectedArea &area = protected_areas[i];
+            if ((x1 >= area.x0) && (x0 <= area.x1) && (y1 >= area.y0) && (y0 <= area.y1)) {
+                area.damaged = true;
+            }
+        }
     }
 
     // Erase a standard sized point by writing the background color to it's location
     void _erase_point(int x, int y) {
         _write_point(_bg_color, x, y);
+
+        Point erased(x, y);
+        _repair_rings_over(&erased, 1);
     }
 
     // clear a point on the screen to make way for the next reading
@@ -265,22 +384,102 @@ public:
     }
 
 
-    void clear_3_within(float angle) {
-        Point pts_to_erase[5];
-        uint8_t erased = 0;
+    // Erase every logged point of a filter bin and drop it from the log.
+    // Points are sorted by row and neighbouring points are merged into shared
+    // windows, so the cost follows the number of points actually there.
+    // Returns the number of points erased.
+    int wipe_bin(int bin) {
+        int num_pts = point_log.take_bin(bin, wipe_points, point_log.buff_size);
+        if (num_pts == 0) return 0;
+
+        _sort_by_row(wipe_points, num_pts);
+
+        // grow a window point by point, writing it out when the next point won't fit.
+        // covered counts the pixels of the points in the window, the union not the sum.
+        int point_area = _point_px * _point_px;
+        int x0, y0, x1, y1, covered;
+        _point_bounds(wipe_points[0], x0, y0, x1, y1);
+        covered = point_area;
+
+        for (int i = 1; i < num_pts; i++) {
+            int px0, py0, px1, py1;
+            _point_bounds(wipe_points[i], px0, py0, px1, py1);
+
+            int mx0 = (px0 < x0) ? px0 : x0;
+            int my0 = (py0 < y0) ? py0 : y0;
+            int mx1 = (px1 > x1) ? px1 : x1;
+            int my1 = (py1 > y1) ? py1 : y1;
+            int merged_area = (mx1 - mx0 + 1) * (my1 - my0 + 1);
+            int merged_covered = covered + point_area - _overlap(x0, y0, x1, y1, px0, py0, px1, py1);
+
+            // only merge when the window stays exactly the points, so nothing
+            // outside them gets painted over
+            if (merged_area == merged_covered) {
+                x0 = mx0; y0 = my0; x1 = mx1; y1 = my1;
+                covered = merged_covered;
+            } else {
+                _tft.fill_rect(_bg_color, x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+                _check_damage(x0, y0, x1, y1);
+                x0 = px0; y0 = py0; x1 = px1; y1 = py1;
+                covered = point_area;
+            }
+        }
+        _tft.fill_rect(_bg_color, x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+        _check_damage(x0, y0, x1, y1);
 
-        point_log.get_x_within(angle, pts_to_erase, 5);
+        _repair_rings_over(wipe_points, num_pts);
+        _redraw_points_over(wipe_points, num_pts);
 
-        for (int i = 0; i < 3; i++) {
-            if (pts_to_erase[i].getx() != 999) {
-                _erase_point(pts_to_erase[i].getx(), pts_to_erase[i].gety());
-                erased++;
+        return num_pts;
+    }
+
+    // Points from neighbouring bins can overlap the wiped ones close to the
+    // center. Redraw any logged point that shares pixels with a wiped point.
+    void _redraw_points_over(Point *wiped, int num_wiped) {
+        for (int i = 0; i < point_log.buff_size; i++) {
+            if (point_log.reading_angles[i] < 0) continue;
+
+            int x0, y0, x1, y1;
+            _point_bounds(point_log.reading_points[i], x0, y0, x1, y1);
+            for (int w = 0; w < num_wiped; w++) {
+                int wx0, wy0, wx1, wy1;
+                _point_bounds(wiped[w], wx0, wy0, wx1, wy1);
+                if (_overlap(x0, y0, x1, y1, wx0, wy0, wx1, wy1) > 0) {
+                    _write_point(_point_color, point_log.reading_points[i].getx(), point_log.reading_points[i].gety());
+                    break;
+                }
             }
         }
-        printf("erased %d points within %f degrees! \n", erased, angle);
     }
 
-    
+    // Number of pixels shared by two rectangles.
+    int _overlap(int ax0, int ay0, int ax1, int ay1, int bx0, int by0, int bx1, int by1) {
+        int w = ((ax1 < bx1) ? ax1 : bx1) - ((ax0 > bx0) ? ax0 : bx0) + 1;
+        int h = ((ay1 < by1) ? ay1 : by1) - ((ay0 > by0) ? ay0 : by0) + 1;
+        if ((w <= 0) || (h <= 0)) return 0;
+        return w * h;
+    }
+
+    // Screen area covered by a point written with _write_point.
+    void _point_bounds(Point &p, int &x0, int &y0, int &x1, int &y1) {
+        x0 = p.getx() - 1;
+        y0 = p.gety() - 1;
+        x1 = x0 + _point_px - 1;
+        y1 = y0 + _point_px - 1;
+    }
+
+    // Insertion sort by row then column, sectors rarely hold more than a few points.
+    void _sort_by_row(Point *pts, int num_pts) {
+        for (int i = 1; i < num_pts; i++) {
+            Point p = pts[i];
+            int j = i;
+            while ((j > 0) && ((pts[j - 1]._y > p._y) || ((pts[j - 1]._y == p._y) && (pts[j - 1]._x > p._x)))) {
+                pts[j] = pts[j - 1];
+                j--;
+            }
+            pts[j] = p;
+        }
+    }
 
 
     int _width, _height, center_x, center_y;
@@ -290,5 +489,21 @@ public:
 
     TFTDriver _tft;
     uint8_t _bg_color[3] = {60 << 2, 60 << 2, 60 << 2};
+    uint8_t _point_color[3] = {0, 63 << 2, 0};
+    uint8_t _ring_color[3] = {0, 0, 0};
+    uint8_t _outline_color[3] = {0, 40 << 2, 63 << 2};
     ReadingBuffer point_log = ReadingBuffer();
+
+    static const int max_protected = 4;
+    ProtectedArea protected_areas[max_protected];
+    int num_protected = 0;
+
+    // Size in pixels of a plotted point, and scratch space for wiping a sector.
+    int _point_px = 3;
+    Point wipe_points[300];
+
+    // Pixels of the circles from plot_circle_at, room for 4 circles.
+    static const int max_ring_points = 4 * 180;
+    Point ring_points[max_ring_points];
+    int num_ring_points = 0;
 };
\ No newline at end of file
@@ -0,0 +1,26 @@
+// Fake ILI9341 memory behind the host spi stubs. CASET/PASET/RAMWR writes land
+// in fake_panel_memory and RAMRD reads come back out of it.
+#pragma once
+
+#include <stdint.h>
+
+const int fake_panel_width = 320;
+const int fake_panel_height = 240;
+// TFTDriver's default data/command pin.
+const unsigned fake_panel_dcx_pin = 24;
+
+// Number of spi_write_blocking calls since the last reset.
+extern long fake_spi_writes;
+
+// Panel command bytes in the order they were sent since the last reset, with
+// fake_event_clock wherever the system or peripheral clock was changed.
+const int fake_max_events = 256;
+const int fake_event_clock = 0x100;
+extern int fake_events[fake_max_events];
+extern int fake_num_events;
+
+// Clear panel memory to 0 and reset the counters.
+void fake_panel_reset();
+
+// The 3 bytes of panel memory at x/y, in the order write_pixel takes them.
+uint8_t *fake_panel_pixel(int x, int y);
@@ -0,0 +1,173 @@
+// Host implementations of the pico sdk calls declared in stubs/.
+// Time only moves when sleep_ms is called. SPI traffic is decoded as ILI9341
+// commands into a fake panel memory, see fake_panel.hpp. Clocks follow the
+// sdk's defaults, clk_peri drops to 48 MHz when the system clock is changed.
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include "hardware/uart.h"
+#include "hardware/clocks.h"
+#include "fake_panel.hpp"
+
+spi_inst_t *spi0 = nullptr;
+uart_inst_t *uart0 = nullptr;
+
+static uint64_t fake_time_us = 0;
+
+void gpio_init(unsigned) {}
+void gpio_set_dir(unsigned, bool) {}
+static bool panel_dcx = false;
+
+void gpio_put(unsigned gpio, bool value) {
+    if (gpio == fake_panel_dcx_pin) panel_dcx = value;
+}
+void gpio_set_function(unsigned, int) {}
+
+void sleep_ms(uint32_t ms) { fake_time_us += ms * 1000ull; }
+absolute_time_t get_absolute_time() { return fake_time_us; }
+uint32_t to_ms_since_boot(absolute_time_t t) { return t / 1000; }
+
+void stdio_init_all() {}
+int getchar_timeout_us(uint32_t) { return PICO_ERROR_TIMEOUT; }
+
+int fake_events[fake_max_events];
+int fake_num_events = 0;
+
+static void log_event(int event) {
+    if (fake_num_events < fake_max_events) fake_events[fake_num_events++] = event;
+}
+
+static uint32_t sys_hz = 125000000;
+static uint32_t peri_hz = 125000000;
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool) {
+    sys_hz = freq_khz * 1000;
+    peri_hz = 48000000;
+    log_event(fake_event_clock);
+    return true;
+}
+
+bool clock_configure(enum clock_index clk_index, uint32_t, uint32_t, uint32_t, uint32_t freq) {
+    if (clk_index == clk_sys) sys_hz = freq;
+    if (clk_index == clk_peri) peri_hz = freq;
+    log_event(fake_event_clock);
+    return true;
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    return (clk_index == clk_peri) ? peri_hz : sys_hz;
+}
+
+// Same divider search as the sdk, so the returned rate is what clk_peri allows.
+static unsigned spi_rate(unsigned baudrate) {
+    uint64_t freq_in = peri_hz;
+    unsigned prescale, postdiv;
+    for (prescale = 2; prescale <= 254; prescale += 2) {
+        if (freq_in < (prescale + 2) * 256 * (uint64_t)baudrate) break;
+    }
+    for (postdiv = 256; postdiv > 1; --postdiv) {
+        if (freq_in / (prescale * (postdiv - 1)) > baudrate) break;
+    }
+    return freq_in / (prescale * postdiv);
+}
+
+unsigned spi_init(spi_inst_t *, unsigned baudrate) { return spi_rate(baudrate); }
+unsigned spi_set_baudrate(spi_inst_t *, unsigned baudrate) { return spi_rate(baudrate); }
+uint8_t fake_panel_memory[fake_panel_height][fake_panel_width][3];
+long fake_spi_writes = 0;
+
+static uint8_t command = 0;
+static uint8_t args[4];
+static int num_args = 0;
+static int col_start = 0, col_end = 0, row_start = 0, row_end = 0;
+static int cur_col = 0, cur_row = 0, cur_byte = 0;
+static bool read_dummy_done = false;
+
+void fake_panel_reset() {
+    memset(fake_panel_memory, 0, sizeof(fake_panel_memory));
+    fake_spi_writes = 0;
+    fake_num_events = 0;
+    command = 0;
+    num_args = 0;
+}
+
+uint8_t *fake_panel_pixel(int x, int y) {
+    return fake_panel_memory[y][x];
+}
+
+static void start_memory_access() {
+    cur_col = col_start;
+    cur_row = row_start;
+    cur_byte = 0;
+    read_dummy_done = false;
+}
+
+// Step through the address window a byte at a time, wrapping columns into rows.
+static uint8_t *next_memory_byte() {
+    uint8_t *byte = nullptr;
+    if ((cur_row <= row_end) && (cur_row < fake_panel_height) && (cur_col < fake_panel_width)) {
+        byte = &fake_panel_memory[cur_row][cur_col][cur_byte];
+    }
+    cur_byte++;
+    if (cur_byte == 3) {
+        cur_byte = 0;
+        cur_col++;
+        if (cur_col > col_end) {
+            cur_col = col_start;
+            cur_row++;
+        }
+    }
+    return byte;
+}
+
+int spi_write_blocking(spi_inst_t *, const uint8_t *src, size_t len) {
+    fake_spi_writes++;
+
+    if (!panel_dcx) {
+        command = src[0];
+        num_args = 0;
+        log_event(command);
+        if ((command == 0x2C) || (command == 0x2E)) start_memory_access();
+        return len;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        if ((command == 0x2A) || (command == 0x2B)) {
+            if (num_args < 4) args[num_args++] = src[i];
+            if (num_args == 4) {
+                int start = (args[0] << 8) | args[1];
+                int end = (args[2] << 8) | args[3];
+                if (command == 0x2A) { col_start = start; col_end = end; }
+                else { row_start = start; row_end = end; }
+            }
+        } else if (command == 0x2C) {
+            uint8_t *byte = next_memory_byte();
+            if (byte) *byte = src[i];
+        }
+    }
+    return len;
+}
+
+int spi_read_blocking(spi_inst_t *, uint8_t, uint8_t *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = 0;
+        if (command != 0x2E) continue;
+
+        // the first byte after RAMRD is a dummy
+        if (!read_dummy_done) {
+            read_dummy_done = true;
+            continue;
+        }
+        uint8_t *byte = next_memory_byte();
+        if (byte) dst[i] = *byte;
+    }
+    return len;
+}
+
+unsigned uart_init(uart_inst_t *, unsigned baudrate) { return baudrate; }
+unsigned uart_set_baudrate(uart_inst_t *, unsigned baudrate) { return baudrate; }
+void uart_write_blocking(uart_inst_t *, const uint8_t *, size_t) {}
+void uart_read_blocking(uart_inst_t *, uint8_t *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) dst[i] = 0;
+}
@@ -0,0 +1,41 @@
+// Fills the fake panel with a test pattern and streams a full screen snapshot
+// to stdout, for test_snap2img.py to decode. The pattern must match
+// expected_pixel in test_snap2img.py.
+#include "fake_panel.hpp"
+#include "tft_driver.hpp"
+#include "screen_snapshot.hpp"
+
+
+void pattern_pixel(int x, int y, uint8_t *px) {
+    switch (y % 3) {
+    case 0:     // one color across the row, longer than a run
+        px[0] = 0x40; px[1] = (y * 4) & 0xFC; px[2] = 0x80;
+        break;
+    case 1:     // short runs
+        px[0] = ((x / 7) * 4) & 0xFC; px[1] = 0x10; px[2] = (y * 4) & 0xFC;
+        break;
+    default:    // no runs at all
+        px[0] = (x % 2) ? 0xFC : 0; px[1] = 0; px[2] = (x * 4) & 0xFC;
+        break;
+    }
+}
+
+int main() {
+    fake_panel_reset();
+    TFTDriver tft;
+
+    for (int y = 0; y < fake_panel_height; y++) {
+        for (int x = 0; x < fake_panel_width; x++) {
+            pattern_pixel(x, y, fake_panel_pixel(x, y));
+        }
+    }
+
+    static ScreenSnapshot snapshot(tft, 7);
+    puts("debug output before the snapshot");
+    snapshot.start(0, 0, tft.width, tft.height);
+    while (snapshot.busy()) {
+        snapshot.poll();
+        puts("sonar loop output between chunks");
+    }
+    return 0;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+unsigned spi_init(spi_inst_t *spi, unsigned baudrate);
+unsigned spi_set_baudrate(spi_inst_t *spi, unsigned baudrate);
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len);
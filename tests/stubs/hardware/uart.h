@@ -0,0 +1,8 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+unsigned uart_init(uart_inst_t *uart, unsigned baudrate);
+unsigned uart_set_baudrate(uart_inst_t *uart, unsigned baudrate);
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+void uart_read_blocking(uart_inst_t *uart, uint8_t *dst, size_t len);
@@ -0,0 +1,38 @@
+// Host stand-in for the parts of pico/stdlib.h the sonar headers use.
+// Implemented in fake_pico.cpp.
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct spi_inst spi_inst_t;
+typedef struct uart_inst uart_inst_t;
+typedef uint64_t absolute_time_t;
+
+extern spi_inst_t *spi0;
+extern uart_inst_t *uart0;
+
+#define PICO_DEFAULT_UART_TX_PIN 0
+#define PICO_DEFAULT_UART_RX_PIN 1
+#define PICO_DEFAULT_SPI_SCK_PIN 18
+#define PICO_DEFAULT_SPI_TX_PIN 19
+#define PICO_DEFAULT_SPI_RX_PIN 20
+#define PICO_ERROR_TIMEOUT -1
+
+enum gpio_function { GPIO_FUNC_SPI = 1, GPIO_FUNC_UART = 2 };
+
+void gpio_init(unsigned gpio);
+void gpio_set_dir(unsigned gpio, bool out);
+void gpio_put(unsigned gpio, bool value);
+void gpio_set_function(unsigned gpio, int fn);
+
+void sleep_ms(uint32_t ms);
+absolute_time_t get_absolute_time();
+uint32_t to_ms_since_boot(absolute_time_t t);
+
+void stdio_init_all();
+int getchar_timeout_us(uint32_t timeout_us);
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required);
@@ -0,0 +1,27 @@
+// Minimal checks for the host tests. Each test binary returns the failure count.
+#pragma once
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long _a = (a), _b = (b); \
+    if (_a != _b) { \
+        printf("%s:%d: CHECK_EQ failed: %s == %s (%lld vs %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define RUN_TEST(fn) do { \
+    int _before = test_failures; \
+    fn(); \
+    printf("%s %s\n", (test_failures == _before) ? "PASS" : "FAIL", #fn); \
+} while (0)
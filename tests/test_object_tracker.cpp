@@ -0,0 +1,159 @@
+// Replays synthetic targets through ObjectTracker.
+#include "test_helpers.hpp"
+#include "object_tracker.hpp"
+
+
+const int num_bins = 128;
+
+// A target covering bins [start_bin, start_bin + width) at range_mm, wrapping past bin 127.
+struct Target {
+    int start_bin;
+    int width;
+    int range_mm;
+};
+
+// Feed one sweep of bins 0-127 with up to two targets, 0 everywhere else.
+// Objects for a sweep are published at the first reading of the sweep after it.
+bool feed_sweep(ObjectTracker &tracker, Target *targets, int num_targets) {
+    bool finished = false;
+
+    for (int bin = 0; bin < num_bins; bin++) {
+        uint16_t distance = 0;
+        for (int t = 0; t < num_targets; t++) {
+            int offset = (bin - targets[t].start_bin + num_bins) % num_bins;
+            if (offset < targets[t].width) distance = targets[t].range_mm;
+        }
+        if (tracker.add_reading(bin, distance)) finished = true;
+    }
+    return finished;
+}
+
+void feed_empty_sweep(ObjectTracker &tracker) {
+    feed_sweep(tracker, nullptr, 0);
+}
+
+
+void test_segments_split_on_range_jump_and_gap() {
+    ObjectTracker tracker(num_bins);
+    Target targets[] = {{10, 5, 1000}, {15, 4, 1500}};
+    feed_sweep(tracker, targets, 2);
+    CHECK(feed_sweep(tracker, nullptr, 0));
+
+    CHECK_EQ(tracker.num_objects, 2);
+    CHECK_EQ(tracker.objects[0].start_bin, 10);
+    CHECK_EQ(tracker.objects[0].end_bin, 14);
+    CHECK_EQ(tracker.objects[0].nearest_mm, 1000);
+    CHECK_EQ(tracker.objects[0].centroid_bin, 12);
+    CHECK_EQ(tracker.objects[1].start_bin, 15);
+    CHECK_EQ(tracker.objects[1].end_bin, 18);
+    CHECK_EQ(tracker.objects[1].centroid_mm, 1500);
+
+    // a gap wider than max_bin_gap splits objects at the same range
+    Target apart[] = {{20, 3, 1000}, {26, 3, 1000}};
+    feed_sweep(tracker, apart, 2);
+    feed_empty_sweep(tracker);
+    CHECK_EQ(tracker.num_objects, 2);
+
+    // a bin the motor steps over gets no reading at all, and doesn't split an object
+    for (int bin = 0; bin < num_bins; bin++) {
+        if (bin == 23) continue;
+        tracker.add_reading(bin, ((bin >= 20) && (bin <= 26)) ? 1000 + (bin - 20) * 5 : 0);
+    }
+    feed_empty_sweep(tracker);
+    CHECK_EQ(tracker.num_objects, 1);
+    CHECK_EQ(tracker.objects[0].start_bin, 20);
+    CHECK_EQ(tracker.objects[0].end_bin, 26);
+}
+
+void test_moving_target_keeps_id_and_velocity() {
+    ObjectTracker tracker(num_bins);
+    int first_id = -1;
+
+    for (int sweep = 0; sweep < 6; sweep++) {
+        // 2 bins and 50 mm closer each sweep
+        Target target = {30 + sweep * 2, 5, 1500 - sweep * 50};
+        feed_sweep(tracker, &target, 1);
+
+        if (sweep < 1) continue;
+        CHECK_EQ(tracker.num_objects, 1);
+        SonarObject &obj = tracker.objects[0];
+        if (sweep == 1) {
+            first_id = obj.id;
+            CHECK_EQ(obj.sweeps_seen, 1);
+            CHECK_EQ(obj.range_rate_mm, 0);
+            continue;
+        }
+        CHECK_EQ(obj.id, first_id);
+        CHECK_EQ(obj.sweeps_seen, sweep);
+        CHECK_EQ(obj.range_rate_mm, -50);
+        CHECK_EQ(obj.bearing_rate_bins, 2);
+    }
+}
+
+void test_objects_out_of_match_range_get_new_ids() {
+    ObjectTracker tracker(num_bins);
+    Target target = {30, 5, 1000};
+    feed_sweep(tracker, &target, 1);
+    Target moved = {90, 5, 1000};
+    feed_sweep(tracker, &moved, 1);
+    feed_empty_sweep(tracker);
+
+    CHECK_EQ(tracker.num_prev_objects, 1);
+    CHECK_EQ(tracker.num_objects, 1);
+    CHECK(tracker.objects[0].id != tracker.prev_objects[0].id);
+    CHECK_EQ(tracker.objects[0].sweeps_seen, 1);
+}
+
+void test_object_across_seam_is_one_object() {
+    ObjectTracker tracker(num_bins);
+    Target target = {125, 6, 1000};
+    feed_sweep(tracker, &target, 1);
+    feed_empty_sweep(tracker);
+
+    CHECK_EQ(tracker.num_objects, 1);
+    SonarObject &obj = tracker.objects[0];
+    CHECK_EQ(obj.start_bin, 125);
+    CHECK_EQ(obj.end_bin, 2);
+    CHECK(obj.end_angle < obj.start_angle);
+    CHECK_EQ(obj.num_readings, 6);
+    // bins 125..130 unwrapped average to 127.5
+    CHECK_EQ(obj.centroid_bin, 127);
+}
+
+void test_target_moving_across_seam() {
+    ObjectTracker tracker(num_bins);
+    int first_id = -1;
+
+    for (int sweep = 0; sweep < 5; sweep++) {
+        Target target = {(122 + sweep * 2) % num_bins, 4, 1200};
+        feed_sweep(tracker, &target, 1);
+
+        if (sweep < 1) continue;
+        CHECK_EQ(tracker.num_objects, 1);
+        if (sweep == 1) {
+            first_id = tracker.objects[0].id;
+            continue;
+        }
+        CHECK_EQ(tracker.objects[0].id, first_id);
+        CHECK_EQ(tracker.objects[0].bearing_rate_bins, 2);
+    }
+}
+
+void test_separate_objects_at_both_ends_stay_apart() {
+    ObjectTracker tracker(num_bins);
+    Target targets[] = {{0, 3, 1000}, {123, 3, 1800}};
+    feed_sweep(tracker, targets, 2);
+    feed_empty_sweep(tracker);
+    CHECK_EQ(tracker.num_objects, 2);
+}
+
+
+int main() {
+    RUN_TEST(test_segments_split_on_range_jump_and_gap);
+    RUN_TEST(test_moving_target_keeps_id_and_velocity);
+    RUN_TEST(test_objects_out_of_match_range_get_new_ids);
+    RUN_TEST(test_object_across_seam_is_one_object);
+    RUN_TEST(test_target_moving_across_seam);
+    RUN_TEST(test_separate_objects_at_both_ends_stay_apart);
+    return test_failures;
+}
@@ -0,0 +1,238 @@
+// Drives PowerManager through quiet and busy sweeps.
+#include "test_helpers.hpp"
+#include "fake_panel.hpp"
+#include "tft_driver.hpp"
+#include "reading_filter.hpp"
+#include "power_manager.hpp"
+
+
+// Run n sweeps of steps_per_sweep steps with nothing changing.
+PowerMode quiet_sweeps(PowerManager &power, int n, int steps_per_sweep=10) {
+    PowerMode mode = power.mode;
+    for (int s = 0; s < n; s++) {
+        for (int i = 0; i < steps_per_sweep; i++) {
+            mode = power.update(false, false, i == 0);
+        }
+    }
+    return mode;
+}
+
+
+void test_idle_and_sleep_thresholds() {
+    PowerManager power(3, 10);
+    // the first sweep boundary ends the sweep the manager started in
+    CHECK_EQ(quiet_sweeps(power, 3), POWER_IDLE);
+    CHECK_EQ(power.quiet_sweeps, 3);
+
+    PowerManager early(3, 10);
+    CHECK_EQ(quiet_sweeps(early, 2), POWER_ACTIVE);
+
+    CHECK_EQ(quiet_sweeps(power, 6), POWER_IDLE);
+    CHECK_EQ(quiet_sweeps(power, 1), POWER_SLEEP);
+    CHECK_EQ(power.quiet_sweeps, 10);
+}
+
+void test_change_wakes_immediately() {
+    PowerManager power;
+    quiet_sweeps(power, 12);
+    CHECK_EQ(power.mode, POWER_SLEEP);
+
+    // mid sweep, not at the boundary
+    CHECK_EQ(power.update(true, false, false), POWER_ACTIVE);
+    CHECK_EQ(power.quiet_sweeps, 0);
+
+    // the sweep with the change doesn't count as quiet
+    CHECK_EQ(power.update(false, false, true), POWER_ACTIVE);
+    CHECK_EQ(power.quiet_sweeps, 0);
+}
+
+void test_early_change_holds_active_for_next_sweep() {
+    PowerManager power(3, 10);
+    quiet_sweeps(power, 4);
+    CHECK_EQ(power.mode, POWER_IDLE);
+
+    CHECK_EQ(power.update(false, true, false), POWER_ACTIVE);
+    CHECK_EQ(power.quiet_sweeps, 4);
+
+    // the woken sweep isn't judged, the next one runs at full rate
+    CHECK_EQ(power.update(false, false, true), POWER_ACTIVE);
+    CHECK_EQ(power.quiet_sweeps, 4);
+    CHECK_EQ(power.update(false, false, false), POWER_ACTIVE);
+
+    // the filter never confirmed it, so that sweep ends quiet and drops back
+    CHECK_EQ(power.update(false, false, true), POWER_IDLE);
+    CHECK_EQ(power.quiet_sweeps, 5);
+}
+
+// Replay a static scene until the panel sleeps, then a target for the given
+// number of sweeps at steps 60-65. Returns the sweep the filter confirmed the
+// change in, or -1. Checks the scan never slows down between the early wake
+// and the change being confirmed or refuted.
+int replay_wake(ReadingFilter &filter, PowerManager &power, int target_sweeps, int &woken_sweep) {
+    float deg_per_step = 2.8 * 1.062;
+    int confirmed = -1;
+    woken_sweep = -1;
+
+    for (int sweep_num = 0; sweep_num < 40; sweep_num++) {
+        int step = 0;
+        for (float angle = 0; angle <= 360; angle += deg_per_step, step++) {
+            uint16_t distance = 1500;
+            bool target_shown = (sweep_num >= 14) && (sweep_num < 14 + target_sweeps);
+            if (target_shown && (step >= 60) && (step <= 65)) distance = 800;
+
+            FilteredReading r = filter.add_sample(distance, angle);
+            PowerMode before = power.mode;
+            PowerMode mode = power.update(r.changed, r.early_change, (step == 0) && (sweep_num > 0));
+
+            if (r.changed && (confirmed < 0) && (sweep_num >= 14)) confirmed = sweep_num;
+            if ((woken_sweep < 0) && (sweep_num >= 14) && (before == POWER_SLEEP) && (mode == POWER_ACTIVE)) {
+                woken_sweep = sweep_num;
+            }
+
+            // from the wake to the end of the sweep after it, no slowing down
+            bool holding = (woken_sweep >= 0) && (sweep_num <= woken_sweep + 1);
+            if (holding && (confirmed < 0)) CHECK_EQ(mode, POWER_ACTIVE);
+        }
+        if (sweep_num == 13) CHECK_EQ(power.mode, POWER_SLEEP);
+    }
+    return confirmed;
+}
+
+void test_real_change_confirmed_before_sleeping_again() {
+    ReadingFilter filter;
+    PowerManager power(3, 10);
+    int woken_sweep;
+
+    int confirmed = replay_wake(filter, power, 40, woken_sweep);
+    CHECK_EQ(woken_sweep, 14);
+    CHECK_EQ(confirmed, 15);
+    // the scene settles again afterwards
+    CHECK_EQ(power.mode, POWER_SLEEP);
+}
+
+void test_refuted_change_sleeps_after_one_sweep() {
+    ReadingFilter filter;
+    PowerManager power(3, 10);
+    int woken_sweep;
+
+    // the target is only there for one sweep, the median never moves
+    int confirmed = replay_wake(filter, power, 1, woken_sweep);
+    CHECK_EQ(woken_sweep, 14);
+    CHECK_EQ(confirmed, -1);
+    CHECK_EQ(power.mode, POWER_SLEEP);
+}
+
+// A scene that stays put, except for one spike each sweep at a different angle.
+void test_lone_spikes_dont_hold_active() {
+    ReadingFilter filter;
+    PowerManager power(3, 10);
+    float deg_per_step = 2.8 * 1.062;
+    int steps = 0;
+    int woken = 0;
+
+    for (int sweep_num = 0; sweep_num < 16; sweep_num++) {
+        int step = 0;
+        for (float angle = 0; angle <= 360; angle += deg_per_step, step++) {
+            uint16_t distance = 1500;
+            // a missed echo, then later a spike
+            if (sweep_num > 3 && step == sweep_num * 7) distance = 4000;
+            if (sweep_num > 3 && step == sweep_num * 7 + 40) distance = 400;
+
+            FilteredReading r = filter.add_sample(distance, angle);
+            PowerMode before = power.mode;
+            PowerMode mode = power.update(r.changed, r.early_change, (step == 0) && (sweep_num > 0));
+            if ((before != POWER_ACTIVE) && (mode == POWER_ACTIVE)) woken++;
+            steps++;
+        }
+    }
+
+    CHECK(steps > 1000);
+    CHECK_EQ(woken, 0);
+    CHECK_EQ(power.mode, POWER_SLEEP);
+}
+
+void test_step_delay_within_wake_latency() {
+    int wake_latency = 500;
+    int panel_wake = 120;
+    PowerManager power(3, 10, wake_latency, panel_wake);
+    CHECK_EQ(power.step_delay_ms(), 0);
+
+    quiet_sweeps(power, 3);
+    CHECK_EQ(power.mode, POWER_IDLE);
+    CHECK(power.step_delay_ms() > 0);
+    CHECK(power.step_delay_ms() <= wake_latency);
+
+    quiet_sweeps(power, 7);
+    CHECK_EQ(power.mode, POWER_SLEEP);
+    CHECK(power.step_delay_ms() > 0);
+    CHECK(power.step_delay_ms() + panel_wake <= wake_latency);
+
+    // a panel slower than the latency budget gets no extra delay
+    PowerManager slow(3, 10, 100, 120);
+    quiet_sweeps(slow, 10);
+    CHECK_EQ(slow.mode, POWER_SLEEP);
+    CHECK_EQ(slow.step_delay_ms(), 0);
+}
+
+
+// Command bytes sent since the last reset, fake_event_clock for clock changes.
+bool events_are(const int *expected, int len) {
+    if (fake_num_events != len) return false;
+    for (int i = 0; i < len; i++) {
+        if (fake_events[i] != expected[i]) return false;
+    }
+    return true;
+}
+
+void test_power_control_command_order() {
+    TFTDriver tft;
+    PowerControl control(tft, uart0, 9600, 37, 281);
+    uint32_t active_spi_hz = spi_set_baudrate(tft.spi, tft.write_mhz * 1000000);
+
+    // clock down before the panel goes partial
+    fake_panel_reset();
+    control.set_mode(POWER_IDLE);
+    int to_idle[] = {fake_event_clock, fake_event_clock, ILI9341_PTLAR, ILI9341_FRMCTR3, ILI9341_PTLON};
+    CHECK(events_are(to_idle, 5));
+
+    fake_panel_reset();
+    control.set_mode(POWER_IDLE);
+    CHECK_EQ(fake_num_events, 0);
+
+    // already partial and clocked down, only the sleep
+    fake_panel_reset();
+    control.set_mode(POWER_SLEEP);
+    int to_sleep[] = {ILI9341_SLPIN};
+    CHECK(events_are(to_sleep, 1));
+
+    fake_panel_reset();
+    control.set_mode(POWER_SLEEP);
+    CHECK_EQ(fake_num_events, 0);
+
+    // wake the panel before anything else touches it
+    fake_panel_reset();
+    control.set_mode(POWER_ACTIVE);
+    int to_active[] = {ILI9341_SLPOUT, ILI9341_NORON, fake_event_clock, fake_event_clock};
+    CHECK(events_are(to_active, 4));
+
+    fake_panel_reset();
+    control.set_mode(POWER_ACTIVE);
+    CHECK_EQ(fake_num_events, 0);
+
+    // spi gets its full rate back once clk_peri follows clk_sys again
+    CHECK_EQ(control.spi_hz, active_spi_hz);
+    CHECK(control.spi_hz > 24000000);
+}
+
+
+int main() {
+    RUN_TEST(test_idle_and_sleep_thresholds);
+    RUN_TEST(test_change_wakes_immediately);
+    RUN_TEST(test_early_change_holds_active_for_next_sweep);
+    RUN_TEST(test_real_change_confirmed_before_sleeping_again);
+    RUN_TEST(test_refuted_change_sleeps_after_one_sweep);
+    RUN_TEST(test_lone_spikes_dont_hold_active);
+    RUN_TEST(test_step_delay_within_wake_latency);
+    RUN_TEST(test_power_control_command_order);
+    return test_failures;
+}
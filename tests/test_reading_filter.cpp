@@ -0,0 +1,200 @@
+// Replays noisy synthetic traces through ReadingFilter.
+#include "test_helpers.hpp"
+#include "reading_filter.hpp"
+
+
+// One sweep with a sample at 10 deg and an empty sample at 200 deg, so the
+// next sweep's first sample wraps the bins. Returns the 10 deg result.
+FilteredReading sweep(ReadingFilter &filter, uint16_t distance_mm) {
+    FilteredReading result = filter.add_sample(distance_mm, 10.0);
+    filter.add_sample(5000, 200.0);
+    return result;
+}
+
+
+void test_target_appears_after_median_catches_up() {
+    ReadingFilter filter;
+
+    FilteredReading r = sweep(filter, 1000);
+    CHECK(!r.changed);
+    CHECK_EQ(r.distance, 0);
+
+    r = sweep(filter, 1000);
+    CHECK(r.changed);
+    CHECK_EQ(r.distance, 1000);
+    CHECK_EQ(r.previous, 0);
+
+    r = sweep(filter, 1000);
+    CHECK(!r.changed);
+    CHECK_EQ(r.distance, 1000);
+}
+
+void test_single_sweep_spike_is_rejected() {
+    ReadingFilter filter;
+    for (int i = 0; i < 3; i++) sweep(filter, 1000);
+
+    FilteredReading r = sweep(filter, 400);
+    CHECK(!r.changed);
+    CHECK_EQ(r.distance, 1000);
+
+    // a single missed echo doesn't clear the target either
+    r = sweep(filter, 4000);
+    CHECK(!r.changed);
+    r = sweep(filter, 1000);
+    CHECK(!r.changed);
+    CHECK_EQ(r.distance, 1000);
+}
+
+void test_glitches_repeat_last_sample() {
+    ReadingFilter filter;
+    for (int i = 0; i < 3; i++) sweep(filter, 1000);
+
+    // back to back 0 and 0xFFFF reads would outvote the target if they counted
+    FilteredReading r = sweep(filter, 0);
+    CHECK(!r.changed);
+    CHECK(!r.early_change);
+    r = sweep(filter, 0xFFFF);
+    CHECK(!r.changed);
+    CHECK(!r.early_change);
+    CHECK_EQ(r.distance, 1000);
+
+    // a glitch on an empty bin doesn't make a target
+    ReadingFilter empty;
+    for (int i = 0; i < 3; i++) {
+        r = sweep(empty, i % 2 ? 0 : 0xFFFF);
+        CHECK(!r.changed);
+        CHECK_EQ(r.distance, 0);
+    }
+}
+
+void test_threshold_hysteresis() {
+    ReadingFilter filter(3000, 40);
+    for (int i = 0; i < 3; i++) sweep(filter, 1000);
+
+    // drifting within the threshold never redraws
+    FilteredReading r;
+    for (int i = 0; i < 4; i++) {
+        r = sweep(filter, 1030);
+        CHECK(!r.changed);
+        CHECK_EQ(r.distance, 1000);
+    }
+
+    // past the threshold it moves once the median agrees
+    r = sweep(filter, 1060);
+    CHECK(!r.changed);
+    r = sweep(filter, 1060);
+    CHECK(r.changed);
+    CHECK_EQ(r.previous, 1000);
+    CHECK_EQ(r.distance, 1060);
+
+    // and the new value is the reference for the next move
+    r = sweep(filter, 1090);
+    r = sweep(filter, 1090);
+    CHECK(!r.changed);
+    CHECK_EQ(r.distance, 1060);
+}
+
+void test_target_leaves() {
+    ReadingFilter filter;
+    for (int i = 0; i < 3; i++) sweep(filter, 1000);
+
+    FilteredReading r = sweep(filter, 3500);
+    CHECK(!r.changed);
+    r = sweep(filter, 3500);
+    CHECK(r.changed);
+    CHECK_EQ(r.previous, 1000);
+    CHECK_EQ(r.distance, 0);
+}
+
+void test_early_change_needs_a_repeat() {
+    ReadingFilter filter;
+    for (int i = 0; i < 3; i++) sweep(filter, 1000);
+
+    // one disagreeing sample is a spike, not a hint
+    FilteredReading r = sweep(filter, 2000);
+    CHECK(!r.early_change);
+    for (int i = 0; i < 2; i++) {
+        r = sweep(filter, 1000);
+        CHECK(!r.early_change);
+    }
+
+    // the same bin disagreeing two sweeps running is
+    sweep(filter, 2000);
+    r = sweep(filter, 2000);
+    CHECK(r.early_change);
+    CHECK(r.changed);
+
+    // so is the step next to it, within one sweep
+    ReadingFilter near;
+    for (int i = 0; i < 3; i++) {
+        near.add_sample(1000, 10.0);
+        near.add_sample(1000, 13.0);
+    }
+    r = near.add_sample(2000, 10.0);
+    CHECK(!r.early_change);
+    r = near.add_sample(2000, 13.0);
+    CHECK(r.early_change);
+    CHECK(!r.changed);
+}
+
+void test_bins_wrap_into_new_sweep() {
+    ReadingFilter filter;
+
+    CHECK_EQ(filter.angle_to_bin(0), 0);
+    CHECK_EQ(filter.angle_to_bin(359.9), filter.num_bins - 1);
+    CHECK_EQ(filter.angle_to_bin(360), filter.num_bins - 1);
+    CHECK_EQ(filter.angle_to_bin(-1), 0);
+
+    // the motor's step angles land in a bin each
+    float deg_per_step = 2.8 * 1.062;
+    int last = -1;
+    for (float angle = 0; angle <= 360; angle += deg_per_step) {
+        int bin = filter.angle_to_bin(angle);
+        CHECK(bin > last);
+        last = bin;
+    }
+
+    // the last bins of a sweep and the restart at 0 deg belong to different sweeps
+    filter.add_sample(1000, 355.0);
+    int ptr = filter.history_ptr;
+    filter.add_sample(1000, 359.5);
+    CHECK_EQ(filter.history_ptr, ptr);
+    filter.add_sample(1000, 0.0);
+    CHECK_EQ(filter.history_ptr, (ptr + 1) % filter.history_len);
+}
+
+void test_noisy_trace_redraws_rarely() {
+    ReadingFilter filter;
+    uint32_t seed = 1;
+    int redraws = 0;
+    float deg_per_step = 2.8 * 1.062;
+
+    for (int sweep_num = 0; sweep_num < 20; sweep_num++) {
+        int step = 0;
+        for (float angle = 0; angle <= 360; angle += deg_per_step, step++) {
+            seed = seed * 1103515245 + 12345;
+            uint16_t distance = 1000 + step * 10 + (seed >> 16) % 30;
+            // roughly one read in twenty is a glitch
+            if (((seed >> 8) % 20) == 0) distance = 0xFFFF;
+
+            FilteredReading r = filter.add_sample(distance, angle);
+            if (r.changed) redraws++;
+        }
+    }
+
+    // one redraw per step to show the scene, jitter under the threshold adds nothing
+    CHECK_EQ(redraws, 122);
+}
+
+
+int main() {
+    RUN_TEST(test_target_appears_after_median_catches_up);
+    RUN_TEST(test_single_sweep_spike_is_rejected);
+    RUN_TEST(test_glitches_repeat_last_sample);
+    RUN_TEST(test_threshold_hysteresis);
+    RUN_TEST(test_target_leaves);
+    RUN_TEST(test_early_change_needs_a_repeat);
+    RUN_TEST(test_bins_wrap_into_new_sweep);
+    RUN_TEST(test_noisy_trace_redraws_rarely);
+    return test_failures;
+}
@@ -0,0 +1,106 @@
+// RLE codec and chunked streaming for ScreenSnapshot.
+#include <string.h>
+
+#include "test_helpers.hpp"
+#include "fake_panel.hpp"
+#include "tft_driver.hpp"
+#include "screen_snapshot.hpp"
+
+
+void test_rle_splits_long_runs() {
+    uint8_t pixels[320 * 3];
+    uint8_t out[320 * 4];
+    for (int i = 0; i < 320; i++) {
+        pixels[i * 3] = 0x10;
+        pixels[i * 3 + 1] = 0x20;
+        pixels[i * 3 + 2] = 0x30;
+    }
+
+    // 320 of one color is a full run of 255 and a run of 65
+    int len = rle_encode_pixels(pixels, 320, out);
+    CHECK_EQ(len, 8);
+    CHECK_EQ(out[0], 255);
+    CHECK_EQ(out[1], 0x10);
+    CHECK_EQ(out[3], 0x30);
+    CHECK_EQ(out[4], 65);
+    CHECK_EQ(out[7], 0x30);
+
+    // exactly 255 is a single run
+    CHECK_EQ(rle_encode_pixels(pixels, 255, out), 4);
+    CHECK_EQ(out[0], 255);
+
+    CHECK_EQ(rle_encode_pixels(pixels, 0, out), 0);
+}
+
+void test_rle_worst_case_and_mixed_runs() {
+    uint8_t pixels[6 * 3] = {
+        1, 2, 3,  1, 2, 3,  1, 2, 4,  9, 9, 9,  9, 9, 9,  9, 9, 9,
+    };
+    uint8_t out[6 * 4];
+
+    int len = rle_encode_pixels(pixels, 6, out);
+    uint8_t expected[] = {2, 1, 2, 3,  1, 1, 2, 4,  3, 9, 9, 9};
+    CHECK_EQ(len, (int)sizeof(expected));
+    CHECK(memcmp(out, expected, sizeof(expected)) == 0);
+
+    // alternating pixels cost 4 bytes each
+    uint8_t alternating[8 * 3];
+    for (int i = 0; i < 8; i++) {
+        memset(&alternating[i * 3], i % 2, 3);
+    }
+    CHECK_EQ(rle_encode_pixels(alternating, 8, out), 32);
+}
+
+void test_poll_sends_rows_per_chunk() {
+    fake_panel_reset();
+    TFTDriver tft;
+    static ScreenSnapshot snapshot(tft, 4);
+
+    CHECK(!snapshot.busy());
+    snapshot.poll();
+    CHECK_EQ(snapshot.next_row, 0);
+
+    snapshot.start(0, 0, 16, 10);
+    CHECK(snapshot.busy());
+
+    snapshot.poll();
+    CHECK_EQ(snapshot.next_row, 4);
+    CHECK(snapshot.busy());
+    snapshot.poll();
+    CHECK_EQ(snapshot.next_row, 8);
+
+    // the last chunk is short and finishes the snapshot
+    snapshot.poll();
+    CHECK_EQ(snapshot.next_row, 10);
+    CHECK(!snapshot.busy());
+
+    // wider than the panel is clamped to the row buffers
+    snapshot.start(0, 0, 400, 1);
+    CHECK_EQ(snapshot._w, ScreenSnapshot::max_width);
+    snapshot.poll();
+    CHECK(!snapshot.busy());
+}
+
+void test_read_block_returns_written_pixels() {
+    fake_panel_reset();
+    TFTDriver tft;
+    uint8_t color[3] = {0x04, 0x08, 0xFC};
+    tft.write_pixel(color, 10, 5, 3);
+
+    uint8_t row[5 * 3];
+    tft.read_block(row, 9, 6, 5, 1);
+    uint8_t empty[3] = {0, 0, 0};
+    CHECK(memcmp(&row[0], empty, 3) == 0);
+    CHECK(memcmp(&row[3], color, 3) == 0);
+    CHECK(memcmp(&row[9], color, 3) == 0);
+    CHECK(memcmp(&row[12], empty, 3) == 0);
+}
+
+
+int main() {
+    RUN_TEST(test_rle_splits_long_runs);
+    RUN_TEST(test_rle_worst_case_and_mixed_runs);
+    RUN_TEST(test_poll_sends_rows_per_chunk);
+    RUN_TEST(test_read_block_returns_written_pixels);
+    return test_failures;
+}
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Round trip a snapshot from snapshot_capture through tools/snap2img.py.
+
+usage: test_snap2img.py <path to snapshot_capture>
+"""
+import os
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "tools"))
+import snap2img  # noqa: E402
+
+
+def expected_pixel(x, y):
+    """Panel bytes for the pattern in snapshot_capture.cpp."""
+    if y % 3 == 0:
+        px = (0x40, (y * 4) & 0xFC, 0x80)
+    elif y % 3 == 1:
+        px = (((x // 7) * 4) & 0xFC, 0x10, (y * 4) & 0xFC)
+    else:
+        px = (0xFC if x % 2 else 0, 0, (x * 4) & 0xFC)
+    # snap2img writes rgb, expanded from the panel's 6 bit blue, green, red
+    return bytes(v | (v >> 6) for v in (px[2], px[1], px[0]))
+
+
+def main():
+    capture = subprocess.run([sys.argv[1]], check=True, capture_output=True, text=True).stdout
+    width, height, rows = snap2img.read_snapshot(capture.splitlines())
+
+    failures = 0
+    if (width, height) != (320, 240):
+        print("wrong size", width, height)
+        failures += 1
+
+    for y in range(height):
+        expected = b"".join(expected_pixel(x, y) for x in range(width))
+        if rows[y] != expected:
+            print("row %d differs" % y)
+            failures += 1
+
+    # decode_row on its own, a run over 255 pixels has to be split in two
+    row = snap2img.decode_row("ff010203" "41010203", 320)
+    if row != bytes((0x03, 0x02, 0x01)) * 320:
+        print("decode_row of split run failed")
+        failures += 1
+
+    # both writers produce a file
+    with tempfile.TemporaryDirectory() as tmp:
+        for name in ("snap.ppm", "snap.png"):
+            path = os.path.join(tmp, name)
+            writer = snap2img.write_png if name.endswith(".png") else snap2img.write_ppm
+            writer(path, width, height, rows)
+            if os.path.getsize(path) == 0:
+                print("empty", name)
+                failures += 1
+
+    print("PASS" if failures == 0 else "FAIL", "snap2img round trip")
+    return failures
+
+
+if __name__ == "__main__":
+    sys.exit(main())
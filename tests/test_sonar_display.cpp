@@ -0,0 +1,295 @@
+// Checks the erase engine against what ends up in the fake panel.
+#include <string.h>
+
+#include "test_helpers.hpp"
+#include "fake_panel.hpp"
+#include "tft_driver.hpp"
+#include "object_tracker.hpp"
+#include "sonar_display.hpp"
+#include "reading_filter.hpp"
+
+
+uint8_t bg[3] = {60 << 2, 60 << 2, 60 << 2};
+uint8_t green[3] = {0, 63 << 2, 0};
+uint8_t marker[3] = {63 << 2, 0, 0};
+
+bool pixel_is(int x, int y, uint8_t *color) {
+    return memcmp(fake_panel_pixel(x, y), color, 3) == 0;
+}
+
+// Green pixels that aren't inside a point still in the log.
+int stale_pixels(SonarDisplay &disp) {
+    ReadingBuffer &log = disp.point_log;
+    int stale = 0;
+
+    for (int y = 0; y < fake_panel_height; y++) {
+        for (int x = 0; x < fake_panel_width; x++) {
+            if (!pixel_is(x, y, green)) continue;
+
+            bool logged = false;
+            for (int i = 0; (i < log.buff_size) && !logged; i++) {
+                if (log.reading_angles[i] < 0) continue;
+                Point &p = log.reading_points[i];
+                logged = (x >= p._x - 1) && (x <= p._x + 1) && (y >= p._y - 1) && (y <= p._y + 1);
+            }
+            if (!logged) stale++;
+        }
+    }
+    return stale;
+}
+
+// Logged points that have lost any of their pixels.
+int damaged_points(SonarDisplay &disp) {
+    ReadingBuffer &log = disp.point_log;
+    int damaged = 0;
+
+    for (int i = 0; i < log.buff_size; i++) {
+        if (log.reading_angles[i] < 0) continue;
+        Point &p = log.reading_points[i];
+
+        bool whole = true;
+        for (int y = p._y - 1; y <= p._y + 1; y++) {
+            for (int x = p._x - 1; x <= p._x + 1; x++) {
+                if (!pixel_is(x, y, green)) whole = false;
+            }
+        }
+        if (!whole) damaged++;
+    }
+    return damaged;
+}
+
+int logged_points(SonarDisplay &disp) {
+    int count = 0;
+    for (int i = 0; i < disp.point_log.buff_size; i++) {
+        if (disp.point_log.reading_angles[i] >= 0) count++;
+    }
+    return count;
+}
+
+
+void test_wipe_doesnt_paint_past_diagonal_points() {
+    fake_panel_reset();
+    TFTDriver tft;
+    tft.fill_screen(60, 60, 60);
+    static SonarDisplay disp(tft, tft.width, tft.height);
+
+    disp.point_log.add_reading(Point(100, 100), 10, 5);
+    disp.point_log.add_reading(Point(101, 101), 10, 5);
+    disp._write_point(green, 100, 100);
+    disp._write_point(green, 101, 101);
+    // corners of the bounding box that neither point covers
+    disp._tft.write_pixel(marker, 102, 99, 1);
+    disp._tft.write_pixel(marker, 99, 102, 1);
+
+    CHECK_EQ(disp.wipe_bin(5), 2);
+    CHECK(pixel_is(102, 99, marker));
+    CHECK(pixel_is(99, 102, marker));
+    CHECK(pixel_is(100, 100, bg));
+    CHECK(pixel_is(102, 102, bg));
+    CHECK_EQ(stale_pixels(disp), 0);
+    CHECK_EQ(logged_points(disp), 0);
+}
+
+void test_wipe_merges_exact_neighbours() {
+    fake_panel_reset();
+    TFTDriver tft;
+    tft.fill_screen(60, 60, 60);
+    static SonarDisplay disp(tft, tft.width, tft.height);
+
+    // a row of overlapping points and a touching point below the first
+    disp.point_log.add_reading(Point(50, 50), 10, 7);
+    disp.point_log.add_reading(Point(51, 50), 10, 7);
+    disp.point_log.add_reading(Point(53, 50), 10, 7);
+    disp.point_log.add_reading(Point(200, 80), 10, 8);
+    disp.point_log.add_reading(Point(200, 83), 10, 8);
+
+    uint32_t windows = disp._tft.windows_opened;
+    CHECK_EQ(disp.wipe_bin(7), 3);
+    CHECK_EQ(disp._tft.windows_opened - windows, 1);
+
+    windows = disp._tft.windows_opened;
+    CHECK_EQ(disp.wipe_bin(8), 2);
+    CHECK_EQ(disp._tft.windows_opened - windows, 1);
+
+    // nothing left, nothing written
+    windows = disp._tft.windows_opened;
+    CHECK_EQ(disp.wipe_bin(7), 0);
+    CHECK_EQ(disp._tft.windows_opened - windows, 0);
+}
+
+void test_replace_reading_windows_per_step() {
+    fake_panel_reset();
+    TFTDriver tft;
+    tft.fill_screen(60, 60, 60);
+    static SonarDisplay disp(tft, tft.width, tft.height);
+
+    // first plot in a bin has nothing to wipe
+    uint32_t windows = disp._tft.windows_opened;
+    disp.replace_reading(1000, 30, 10);
+    CHECK_EQ(disp._tft.windows_opened - windows, 1);
+
+    // a move wipes the old point and plots the new one
+    windows = disp._tft.windows_opened;
+    disp.replace_reading(2000, 30, 10);
+    CHECK_EQ(disp._tft.windows_opened - windows, 2);
+
+    // a target leaving only wipes
+    windows = disp._tft.windows_opened;
+    disp.replace_reading(0, 30, 10);
+    CHECK_EQ(disp._tft.windows_opened - windows, 1);
+    CHECK_EQ(stale_pixels(disp), 0);
+}
+
+// Close to the center the points of neighbouring bins overlap, wiping one bin
+// has to leave the point next to it whole.
+void test_wipe_keeps_overlapping_neighbours() {
+    fake_panel_reset();
+    TFTDriver tft;
+    tft.fill_screen(60, 60, 60);
+    static SonarDisplay disp(tft, tft.width, tft.height);
+
+    disp.replace_reading(300, 0, 0);
+    disp.replace_reading(300, 2.97, 1);
+    CHECK_EQ(damaged_points(disp), 0);
+
+    disp.replace_reading(0, 2.97, 1);
+    CHECK_EQ(logged_points(disp), 1);
+    CHECK_EQ(damaged_points(disp), 0);
+    CHECK_EQ(stale_pixels(disp), 0);
+}
+
+// Drive the display the way the main loop does, with a scene that moves
+// every few sweeps, and check no point outlives its bin.
+void test_no_stale_points_after_full_sweeps() {
+    fake_panel_reset();
+    TFTDriver tft;
+    tft.fill_screen(60, 60, 60);
+    static SonarDisplay disp(tft, tft.width, tft.height);
+    static ReadingFilter filter;
+    float deg_per_step = 2.8 * 1.062;
+    uint32_t seed = 7;
+
+    for (int sweep_num = 0; sweep_num < 24; sweep_num++) {
+        int step = 0;
+        for (float angle = 0; angle <= 360; angle += deg_per_step, step++) {
+            seed = seed * 1103515245 + 12345;
+            uint16_t distance = 600 + ((step * 37 + (sweep_num / 4) * 400) % 2600);
+            if (((seed >> 8) % 10) == 0) distance = 0xFFFF;
+
+            FilteredReading r = filter.add_sample(distance, angle);
+            uint32_t windows = disp._tft.windows_opened;
+            if (r.changed) disp.replace_reading(r.distance, angle, r.bin);
+            // a wipe, a plot and the neighbours either side
+            CHECK(disp._tft.windows_opened - windows <= 4);
+        }
+        CHECK_EQ(stale_pixels(disp), 0);
+        CHECK_EQ(damaged_points(disp), 0);
+    }
+    CHECK(logged_points(disp) > 0);
+
+    // the scene emptying clears the plot
+    for (int sweep_num = 0; sweep_num < 3; sweep_num++) {
+        for (float angle = 0; angle <= 360; angle += deg_per_step) {
+            FilteredReading r = filter.add_sample(5000, angle);
+            if (r.changed) disp.replace_reading(r.distance, angle, r.bin);
+        }
+    }
+    CHECK_EQ(logged_points(disp), 0);
+    CHECK_EQ(stale_pixels(disp), 0);
+}
+
+// An object outline is erased and redrawn as a target approaches, which must
+// not eat into the target's own points. Replays the main loop's filter,
+// tracker and display calls.
+void test_outline_redraw_keeps_approaching_points() {
+    fake_panel_reset();
+    TFTDriver tft;
+    tft.fill_screen(60, 60, 60);
+    static SonarDisplay disp(tft, tft.width, tft.height);
+    static ReadingFilter filter;
+    static ObjectTracker tracker(filter.num_bins);
+    float deg_per_step = 2.8 * 1.062;
+    int outlines_drawn = 0;
+
+    for (int sweep_num = 0; sweep_num < 10; sweep_num++) {
+        int step = 0;
+        for (float angle = 0; angle <= 360; angle += deg_per_step, step++) {
+            uint16_t distance = 5000;
+            if ((step >= 20) && (step < 30)) distance = (sweep_num < 5) ? 1500 : 1380;
+
+            FilteredReading r = filter.add_sample(distance, angle);
+            if (r.changed) disp.replace_reading(r.distance, angle, r.bin);
+
+            if (tracker.add_reading(r.bin, r.distance)) {
+                disp.redraw_object_outlines(tracker.prev_objects, tracker.num_prev_objects,
+                    tracker.objects, tracker.num_objects);
+                outlines_drawn += tracker.num_objects;
+            }
+        }
+    }
+
+    CHECK(outlines_drawn > 0);
+    CHECK_EQ(logged_points(disp), 10);
+    CHECK_EQ(damaged_points(disp), 0);
+}
+
+// Ring pixels that are neither black nor under a logged point.
+int missing_ring_pixels(SonarDisplay &disp) {
+    uint8_t black[3] = {0, 0, 0};
+    int missing = 0;
+
+    for (int i = 0; i < disp.num_ring_points; i++) {
+        Point &p = disp.ring_points[i];
+        if (pixel_is(p._x, p._y, black)) continue;
+        if (!disp._on_logged_point(p._x, p._y)) missing++;
+    }
+    return missing;
+}
+
+// Targets crossing a range ring wipe and outline over it, the ring has to
+// come back every time.
+void test_ring_survives_targets_crossing_it() {
+    fake_panel_reset();
+    TFTDriver tft;
+    tft.fill_screen(60, 60, 60);
+    static SonarDisplay disp(tft, tft.width, tft.height);
+    static ReadingFilter filter;
+    static ObjectTracker tracker(filter.num_bins);
+    float deg_per_step = 2.8 * 1.062;
+
+    disp.plot_circle_at(1000);
+    CHECK_EQ(disp.num_ring_points, 180);
+
+    // an arc of targets walking in across the ring, then leaving
+    for (int sweep_num = 0; sweep_num < 30; sweep_num++) {
+        int step = 0;
+        for (float angle = 0; angle <= 360; angle += deg_per_step, step++) {
+            uint16_t distance = 5000;
+            if ((sweep_num < 27) && (step >= 10) && (step < 60)) {
+                distance = 1150 - (sweep_num / 3) * 40 + (step % 4) * 10;
+            }
+
+            FilteredReading r = filter.add_sample(distance, angle);
+            if (r.changed) disp.replace_reading(r.distance, angle, r.bin);
+
+            if (tracker.add_reading(r.bin, r.distance)) {
+                disp.redraw_object_outlines(tracker.prev_objects, tracker.num_prev_objects,
+                    tracker.objects, tracker.num_objects);
+            }
+        }
+        CHECK_EQ(missing_ring_pixels(disp), 0);
+    }
+    CHECK_EQ(logged_points(disp), 0);
+}
+
+
+int main() {
+    RUN_TEST(test_wipe_doesnt_paint_past_diagonal_points);
+    RUN_TEST(test_wipe_merges_exact_neighbours);
+    RUN_TEST(test_replace_reading_windows_per_step);
+    RUN_TEST(test_wipe_keeps_overlapping_neighbours);
+    RUN_TEST(test_no_stale_points_after_full_sweeps);
+    RUN_TEST(test_outline_redraw_keeps_approaching_points);
+    RUN_TEST(test_ring_survives_targets_crossing_it);
+    return test_failures;
+}
@@ -0,0 +1,184 @@
+// Checks the text rendered into the fake panel and the windows it takes.
+#include <string.h>
+
+#include "test_helpers.hpp"
+#include "fake_panel.hpp"
+#include "tft_driver.hpp"
+#include "object_tracker.hpp"
+#include "sonar_display.hpp"
+#include "text_display.hpp"
+
+
+uint8_t white[3] = {63 << 2, 63 << 2, 63 << 2};
+uint8_t bg[3] = {60 << 2, 60 << 2, 60 << 2};
+
+bool pixel_is(int x, int y, uint8_t *color) {
+    return memcmp(fake_panel_pixel(x, y), color, 3) == 0;
+}
+
+// Compare one character cell on the panel against the font.
+bool cell_matches(int x, int y, char c) {
+    int idx = c - font_first_char;
+    for (int row = 0; row < GlyphCache::cell_height; row++) {
+        for (int col = 0; col < GlyphCache::cell_width; col++) {
+            bool on = (col < font_width) && (row < font_height) && ((font_5x7[idx][col] >> row) & 1);
+            if (!pixel_is(x + col, y + row, on ? white : bg)) return false;
+        }
+    }
+    return true;
+}
+
+
+void test_draw_text_renders_glyphs_in_one_window() {
+    fake_panel_reset();
+    TFTDriver tft;
+    static GlyphCache glyphs(tft, white, bg);
+
+    uint32_t windows = tft.windows_opened;
+    glyphs.draw_text(10, 20, "A1:", 3);
+    CHECK_EQ(tft.windows_opened - windows, 1);
+
+    CHECK(cell_matches(10, 20, 'A'));
+    CHECK(cell_matches(16, 20, '1'));
+    CHECK(cell_matches(22, 20, ':'));
+    // nothing written past the run
+    CHECK(pixel_is(28, 20, (uint8_t *)"\0\0\0"));
+
+    // lower case uses the upper case glyph, out of range characters draw '?'
+    glyphs.draw_text(10, 40, "a~", 2);
+    CHECK(cell_matches(10, 40, 'A'));
+    CHECK(cell_matches(16, 40, '?'));
+
+    // glyphs are expanded once and reused
+    CHECK(glyphs.expanded[glyphs.glyph_index('A')]);
+    CHECK(!glyphs.expanded[glyphs.glyph_index('Z')]);
+}
+
+void test_hud_line_only_writes_changed_runs() {
+    fake_panel_reset();
+    TFTDriver tft;
+    static GlyphCache glyphs(tft, white, bg);
+    HudLine line(glyphs, 4, 4, 10);
+
+    uint32_t windows = tft.windows_opened;
+    line.update("ANG 123.4");
+    CHECK_EQ(tft.windows_opened - windows, 1);
+    CHECK(cell_matches(4, 4, 'A'));
+    CHECK(cell_matches(4 + 8 * 6, 4, '4'));
+
+    // unchanged text costs nothing
+    windows = tft.windows_opened;
+    long writes = fake_spi_writes;
+    line.update("ANG 123.4");
+    CHECK_EQ(tft.windows_opened - windows, 0);
+    CHECK_EQ(fake_spi_writes - writes, 0);
+
+    // one changed run, one window
+    windows = tft.windows_opened;
+    line.update("ANG 123.7");
+    CHECK_EQ(tft.windows_opened - windows, 1);
+    CHECK(cell_matches(4 + 8 * 6, 4, '7'));
+    CHECK(cell_matches(4 + 7 * 6, 4, '.'));
+
+    // two separate runs, two windows
+    windows = tft.windows_opened;
+    line.update("ANG 923.8");
+    CHECK_EQ(tft.windows_opened - windows, 2);
+    CHECK(cell_matches(4 + 4 * 6, 4, '9'));
+    CHECK(cell_matches(4 + 8 * 6, 4, '8'));
+
+    // shorter text blanks the rest of the line
+    line.update("ANG 9");
+    for (int i = 5; i < 10; i++) {
+        CHECK(cell_matches(4 + i * 6, 4, ' '));
+    }
+}
+
+void test_ring_labels_clear_of_rings_and_repaired() {
+    fake_panel_reset();
+    TFTDriver tft;
+    tft.fill_screen(60, 60, 60);
+    static SonarDisplay disp(tft, tft.width, tft.height);
+    static SonarHud hud(disp);
+
+    hud.label_ring(disp, 1000);
+    hud.label_ring(disp, 2000);
+    CHECK_EQ(hud.num_labels, 2);
+
+    // every ring pixel survives the labels
+    uint8_t black[3] = {0, 0, 0};
+    int rings[] = {1000, 2000};
+    for (int r = 0; r < 2; r++) {
+        int px = disp.map_mm_distance_to_px_distance(rings[r]);
+        for (int angle = 0; angle < 360; angle += 2) {
+            Point p = disp.reading_to_point(px, angle);
+            CHECK(pixel_is(p.getx(), p.gety(), black));
+        }
+    }
+
+    SonarHud::RingLabel &label = hud.labels[0];
+    CHECK(cell_matches(label.x, label.y, label.text[0]));
+
+    // a point plotted onto the label damages it, repair draws it back in one window
+    Point inside(label.x + 2, label.y + 3);
+    disp._write_point(disp._bg_color, inside.getx(), inside.gety());
+    CHECK(disp.protected_areas[label.area].damaged);
+    CHECK(!cell_matches(label.x, label.y, label.text[0]));
+
+    uint32_t windows = disp._tft.windows_opened;
+    hud.repair_labels(disp);
+    CHECK_EQ(disp._tft.windows_opened - windows, 1);
+    CHECK(cell_matches(label.x, label.y, label.text[0]));
+    CHECK(!disp.protected_areas[label.area].damaged);
+
+    // nothing to repair, nothing written
+    windows = disp._tft.windows_opened;
+    hud.repair_labels(disp);
+    CHECK_EQ(disp._tft.windows_opened - windows, 0);
+}
+
+// The live lines have to stay clear of the plot, and inside the columns the
+// panel keeps refreshing in partial mode.
+void test_hud_lines_inside_partial_area_outside_plot() {
+    fake_panel_reset();
+    TFTDriver tft;
+    static SonarDisplay disp(tft, tft.width, tft.height);
+    static SonarHud hud(disp);
+
+    int r = disp.plot_radius_px();
+    int partial_start = disp.center_x - r - 2;
+    int partial_end = disp.center_x + r + 2;
+
+    HudLine *lines[] = {&hud.angle_line, &hud.range_line, &hud.loop_line};
+    for (int i = 0; i < 3; i++) {
+        int x0 = lines[i]->_x;
+        int y0 = lines[i]->_y;
+        int x1 = x0 + SonarHud::line_chars * GlyphCache::cell_width - 1;
+        int y1 = y0 + GlyphCache::cell_height - 1;
+
+        CHECK(x0 >= partial_start);
+        CHECK(x1 <= partial_end);
+        CHECK(y0 >= 0);
+        CHECK(y1 < disp._height);
+
+        // nearest pixel of the line to the plot center is outside the outer ring
+        int nx = (disp.center_x < x0) ? x0 : (disp.center_x > x1) ? x1 : disp.center_x;
+        int ny = (disp.center_y < y0) ? y0 : (disp.center_y > y1) ? y1 : disp.center_y;
+        int dx = nx - disp.center_x;
+        int dy = ny - disp.center_y;
+        CHECK(dx * dx + dy * dy > (r + 1) * (r + 1));
+    }
+
+    // the widest readouts fit their lines
+    hud.update(359.9, 2999, 999, 99);
+    CHECK(cell_matches(hud.range_line._x + 9 * GlyphCache::cell_width, hud.range_line._y, 'M'));
+}
+
+
+int main() {
+    RUN_TEST(test_draw_text_renders_glyphs_in_one_window);
+    RUN_TEST(test_hud_line_only_writes_changed_runs);
+    RUN_TEST(test_ring_labels_clear_of_rings_and_repaired);
+    RUN_TEST(test_hud_lines_inside_partial_area_outside_plot);
+    return test_failures;
+}
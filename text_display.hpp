@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "font_5x7.hpp"
+
+
+// Renders text with the 5x7 font. Each glyph is expanded once, on first use,
+// into a block of panel formatted pixels (3 bytes per pixel) with a column and
+// row of background for spacing. A run of text is then sent in one address
+// window by copying rows out of the cached glyphs.
+class GlyphCache {
+public:
+
+    GlyphCache(TFTDriver &tft, uint8_t *fg_color, uint8_t *bg_color) : _tft(tft) {
+        for (int i = 0; i < 3; i++) {
+            _fg[i] = fg_color[i];
+            _bg[i] = bg_color[i];
+        }
+        for (int i = 0; i < num_glyphs; i++) {
+            expanded[i] = false;
+        }
+    }
+
+    // Index of the cached glyph for a character, unknown characters draw as '?'.
+    int glyph_index(char c) {
+        if ((c >= 'a') && (c <= 'z')) c = c - 'a' + 'A';
+        if ((c < font_first_char) || (c > font_last_char)) c = '?';
+        return c - font_first_char;
+    }
+
+    // Pixels for a character, expanding it from the font the first time it's used.
+    const uint8_t *glyph(char c) {
+        int idx = glyph_index(c);
+        if (!expanded[idx]) _expand(idx);
+        return glyph_px[idx];
+    }
+
+    // Draw len characters of text with its top left corner at x/y, in one window.
+    void draw_text(uint16_t x, uint16_t y, const char *text, int len) {
+        if (len <= 0) return;
+        if (len > max_run) len = max_run;
+
+        const uint8_t *glyphs[max_run];
+        for (int i = 0; i < len; i++) {
+            glyphs[i] = glyph(text[i]);
+        }
+
+        _tft.set_window(x, y, len * cell_width, cell_height);
+        _tft.set_data();
+
+        int glyph_row_bytes = cell_width * 3;
+        for (int row = 0; row < cell_height; row++) {
+            for (int i = 0; i < len; i++) {
+                memcpy(&row_buff[i * glyph_row_bytes], &glyphs[i][row * glyph_row_bytes], glyph_row_bytes);
+            }
+            spi_write_blocking(_tft.spi, row_buff, len * glyph_row_bytes);
+        }
+    }
+
+    void _expand(int idx) {
+        uint8_t *px = glyph_px[idx];
+
+        for (int row = 0; row < cell_height; row++) {
+            for (int col = 0; col < cell_width; col++) {
+                bool on = (col < font_width) && (row < font_height)
+                    && ((font_5x7[idx][col] >> row) & 1);
+                uint8_t *color = on ? _fg : _bg;
+
+                for (int i = 0; i < 3; i++) {
+                    *px++ = color[i];
+                }
+            }
+        }
+        expanded[idx] = true;
+    }
+
+
+    static const int cell_width = font_width + 1;
+    static const int cell_height = font_height + 1;
+    static const int num_glyphs = font_last_char - font_first_char + 1;
+    // Longest run of characters sent in one window.
+    static const int max_run = 32;
+
+    TFTDriver &_tft;
+    uint8_t _fg[3];
+    uint8_t _bg[3];
+
+    uint8_t glyph_px[num_glyphs][cell_width * cell_height * 3];
+    bool expanded[num_glyphs];
+    uint8_t row_buff[max_run * cell_width * 3];
+};
+
+
+// A fixed position line of text that only redraws the characters that
+// changed since the last update.
+class HudLine {
+public:
+
+    HudLine(GlyphCache &glyphs, int x, int y, int max_chars)
+        : _glyphs(glyphs), _x(x), _y(y) {
+        _max_chars = (max_chars > max_len) ? max_len : max_chars;
+        // start with something that can't match so the first update draws everything
+        for (int i = 0; i < _max_chars; i++) {
+            shown[i] = 0;
+        }
+    }
+
+    // Show text, padding with spaces up to the line length.
+    // Each run of changed characters is written in one window.
+    void update(const char *text) {
+        char next[max_len];
+        int text_len = strlen(text);
+
+        for (int i = 0; i < _max_chars; i++) {
+            next[i] = (i < text_len) ? text[i] : ' ';
+        }
+
+        int i = 0;
+        while (i < _max_chars) {
+            if (next[i] == shown[i]) {
+                i++;
+                continue;
+            }
+
+            int run_start = i;
+            while ((i < _max_chars) && (next[i] != shown[i])) {
+                shown[i] = next[i];
+                i++;
+            }
+            _glyphs.draw_text(_x + run_start * GlyphCache::cell_width, _y, &next[run_start], i - run_start);
+        }
+    }
+
+    static const int max_len = 32;
+
+    GlyphCache &_glyphs;
+    int _x, _y, _max_chars;
+    char shown[max_len];
+};
+
+
+// On screen readout for the sonar. Labels the range rings and shows the
+// current angle, range and loop stats in the corners around the plot. The lines
+// stay within the plot's columns, which the panel keeps refreshing in partial mode.
+class SonarHud {
+public:
+
+    SonarHud(SonarDisplay &disp)
+        : glyphs(disp._tft, _text_color, disp._bg_color),
+          angle_line(glyphs, _left(disp), 2, line_chars),
+          range_line(glyphs, _right(disp) - line_chars * GlyphCache::cell_width, 2, line_chars),
+          loop_line(glyphs, _left(disp), disp._height - GlyphCache::cell_height - 2, line_chars) {}
+
+    // First and one past the last column a line can use.
+    static int _left(SonarDisplay &disp) {
+        return disp.center_x - disp.plot_radius_px() + 2;
+    }
+    static int _right(SonarDisplay &disp) {
+        return disp.center_x + disp.plot_radius_px() - 1;
+    }
+
+    // Draw a range ring with its distance written just outside it, at 45 degrees.
+    // The display repairs the ring itself. The label sits in the swept area too,
+    // so it's registered with the display and redrawn by repair_labels when the
+    // plot writes over it.
+    void label_ring(SonarDisplay &disp, int distance_mm) {
+        disp.plot_circle_at(distance_mm);
+        if (num_labels >= max_labels) return;
+
+        RingLabel &label = labels[num_labels];
+        snprintf(label.text, sizeof(label.text), "%.1fM", distance_mm / 1000.0);
+
+        // up and right of the ring point, so the label cells stay clear of the ring
+        int ring_px = disp.map_mm_distance_to_px_distance(distance_mm);
+        Point p = disp.reading_to_point(ring_px, 45);
+        label.x = p.getx() + 3;
+        label.y = p.gety() - GlyphCache::cell_height - 2;
+        label.len = strlen(label.text);
+        label.area = disp.protect_area(label.x, label.y, label.len * GlyphCache::cell_width, GlyphCache::cell_height);
+
+        glyphs.draw_text(label.x, label.y, label.text, label.len);
+        num_labels++;
+    }
+
+    // Redraw ring labels the plot has written over since the last call.
+    void repair_labels(SonarDisplay &disp) {
+        for (int i = 0; i < num_labels; i++) {
+            RingLabel &label = labels[i];
+            if ((label.area < 0) || !disp.protected_areas[label.area].damaged) continue;
+
+            glyphs.draw_text(label.x, label.y, label.text, label.len);
+            disp.protected_areas[label.area].damaged = false;
+        }
+    }
+
+    // Refresh the live readout. distance_mm of 0 means no target.
+    void update(float angle, int distance_mm, uint32_t loop_ms, uint32_t windows_per_step) {
+        char text[HudLine::max_len];
+
+        snprintf(text, sizeof(text), "ANG %5.1f", angle);
+        angle_line.update(text);
+
+        if (distance_mm == 0) snprintf(text, sizeof(text), "RNG  ----");
+        else snprintf(text, sizeof(text), "RNG %4dMM", distance_mm);
+        range_line.update(text);
+
+        snprintf(text, sizeof(text), "%3dMS %2dW", (int)loop_ms, (int)windows_per_step);
+        loop_line.update(text);
+    }
+
+    // Lines are kept short enough to stay clear of the outer ring.
+    static const int line_chars = 10;
+
+    struct RingLabel {
+        char text[12];
+        int len;
+        int x, y;
+        int area;
+    };
+    static const int max_labels = 4;
+    RingLabel labels[max_labels];
+    int num_labels = 0;
+
+    uint8_t _text_color[3] = {63 << 2, 63 << 2, 63 << 2};
+    GlyphCache glyphs;
+    HudLine angle_line;
+    HudLine range_line;
+    HudLine loop_line;
+};
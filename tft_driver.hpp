@@ -159,12 +159,66 @@ public:
         }
     }
 
-    void write_pixel(uint8_t *color, uint16_t x, uint16_t y, uint8_t sz=1) {
-
-        colset(x, x + sz - 1);
-        paset(y, y + sz -1 );
+    // Set the address window to a w x h block at x/y and start a memory write.
+    // Pixel data sent after this fills the block row by row.
+    void set_window(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+        colset(x, x + w - 1);
+        paset(y, y + h - 1);
 
         send_command(MEMWRT);
+        windows_opened++;
+    }
+
+    // Write a w x h block of pre-formatted pixel data (3 bytes per pixel) in one window.
+    void write_block(const uint8_t *pixels, uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+        set_window(x, y, w, h);
+
+        set_data();
+        spi_write_blocking(spi, pixels, w * h * 3);
+    }
+
+    // Read a w x h block of pixels back from display memory into pixels, 3 bytes
+    // per pixel in the same order write_pixel takes them. The panel can't be read
+    // at the write clock, so spi is slowed down for the read and restored after.
+    void read_block(uint8_t *pixels, uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+        colset(x, x + w - 1);
+        paset(y, y + h - 1);
+
+        send_command(MEMREAD);
+
+        spi_set_baudrate(spi, read_mhz * 1000000);
+        set_data();
+
+        // first byte clocked out after RAMRD is a dummy read
+        uint8_t dummy;
+        spi_read_blocking(spi, 0, &dummy, 1);
+        spi_read_blocking(spi, 0, pixels, w * h * 3);
+
+        spi_set_baudrate(spi, write_mhz * 1000000);
+    }
+
+    // Fill a w x h rectangle with one color in a single window, sent a row at a time.
+    void fill_rect(uint8_t *color, uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+        uint8_t row_buff[320 * 3];
+        if (w > 320) w = 320;
+
+        for (int i = 0; i < w; i++) {
+            row_buff[i * 3] = color[0];
+            row_buff[i * 3 + 1] = color[1];
+            row_buff[i * 3 + 2] = color[2];
+        }
+
+        set_window(x, y, w, h);
+
+        set_data();
+        for (int row = 0; row < h; row++) {
+            spi_write_blocking(spi, row_buff, w * 3);
+        }
+    }
+
+    void write_pixel(uint8_t *color, uint16_t x, uint16_t y, uint8_t sz=1) {
+
+        set_window(x, y, sz, sz);
         //printf("writing color: %d, %d, %d\n", color[2], color[1], color[0]);
 
         for (int i = 0; i < (sz * sz); i++) {
@@ -175,10 +229,44 @@ public:
     }
 
 
+    // Only refresh panel rows start_row to end_row, the rest of the panel shows the
+    // non-display color. Rows are the panel's gate lines, which run across the
+    // screen's x axis in this landscape orientation.
+    void enter_partial(uint16_t start_row, uint16_t end_row, uint8_t frame_divider=0x03, uint8_t frame_rtna=0x1F) {
+        send_command(ILI9341_PTLAR);
+        uint8_t args_ptlar[] = {
+            (uint8_t)(start_row >> 8), (uint8_t)(start_row & 0xFF),
+            (uint8_t)(end_row >> 8), (uint8_t)(end_row & 0xFF)
+        };
+        send_data(args_ptlar, 4);
+
+        // slowest frame rate while in partial mode
+        send_command(ILI9341_FRMCTR3);
+        uint8_t args_frmctr3[] = {frame_divider, frame_rtna};
+        send_data(args_frmctr3, 2);
+
+        send_command(ILI9341_PTLON);
+    }
+
+    // Back to full frame refresh.
+    void exit_partial() {
+        send_command(ILI9341_NORON);
+    }
+
+    // Stop the panel refreshing, display memory can still be written while asleep.
+    void sleep_in() {
+        send_command(ILI9341_SLPIN);
+        sleep_ms(5);
+    }
+
+    void sleep_out() {
+        send_command(ILI9341_SLPOUT);
+        sleep_ms(sleep_out_ms);
+    }
+
     void init() {
         puts("Running ILI9340 Startup Sequence!");
-        float mhz = 50;
-        spi_init(spi0, mhz * 1000000);
+        spi_init(spi0, write_mhz * 1000000);
         gpio_set_function(PICO_DEFAULT_SPI_TX_PIN, GPIO_FUNC_SPI);
         gpio_set_function(PICO_DEFAULT_SPI_RX_PIN, GPIO_FUNC_SPI);
         gpio_set_function(PICO_DEFAULT_SPI_SCK_PIN, GPIO_FUNC_SPI);
@@ -300,4 +388,14 @@ public:
     int width = 320;
     int height = 240;
     spi_inst_t *spi;
+
+    // SPI clock for writes, and the slower clock the panel needs for reads.
+    float write_mhz = 50;
+    float read_mhz = 6;
+
+    // Time the panel needs after a sleep out before it takes commands.
+    int sleep_out_ms = 120;
+
+    // Count of address windows set since startup, each costs a CASET/PASET/RAMWR exchange.
+    uint32_t windows_opened = 0;
 };
\ No newline at end of file
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Convert a pico-sonar screen snapshot capture into a PPM or PNG image.
+
+Capture the usb serial output while sending 's' to the board, e.g.
+    cat /dev/ttyACM0 > capture.txt
+then run
+    snap2img.py capture.txt snapshot.png
+
+Only lines starting with SNAP are used, the rest of the debug output is skipped.
+The output format is picked from the file extension (.png, anything else is PPM).
+"""
+import struct
+import sys
+import zlib
+
+
+def decode_row(hex_runs, width):
+    """Expand a hex encoded row of (count, b0, b1, b2) runs into RGB bytes."""
+    data = bytes.fromhex(hex_runs)
+    row = bytearray()
+    for i in range(0, len(data) - 3, 4):
+        count, b0, b1, b2 = data[i:i + 4]
+        # panel bytes are blue, green, red with 6 bit values in the top bits
+        rgb = bytes(v | (v >> 6) for v in (b2, b1, b0))
+        row += rgb * count
+    row = row[:width * 3]
+    return row + bytes(width * 3 - len(row))
+
+
+def read_snapshot(lines):
+    """Return (width, height, rows) for the last complete snapshot in lines."""
+    snapshot = None
+    current = None
+    for line in lines:
+        parts = line.strip().split(" ")
+        if len(parts) < 2 or parts[0] != "SNAP":
+            continue
+        if parts[1] == "BEGIN":
+            width, height = int(parts[2]), int(parts[3])
+            current = (width, height, [bytes(width * 3)] * height)
+        elif parts[1] == "ROW" and current is not None:
+            width, height, rows = current
+            y = int(parts[2])
+            if 0 <= y < height:
+                rows[y] = decode_row(parts[3] if len(parts) > 3 else "", width)
+        elif parts[1] == "END" and current is not None:
+            snapshot = current
+            current = None
+    if snapshot is None:
+        sys.exit("no complete snapshot found")
+    return snapshot
+
+
+def write_ppm(path, width, height, rows):
+    with open(path, "wb") as f:
+        f.write(b"P6\n%d %d\n255\n" % (width, height))
+        for row in rows:
+            f.write(row)
+
+
+def write_png(path, width, height, rows):
+    def chunk(kind, data):
+        body = kind + data
+        return struct.pack(">I", len(data)) + body + struct.pack(">I", zlib.crc32(body))
+
+    raw = b"".join(b"\x00" + row for row in rows)
+    with open(path, "wb") as f:
+        f.write(b"\x89PNG\r\n\x1a\n")
+        f.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0)))
+        f.write(chunk(b"IDAT", zlib.compress(raw)))
+        f.write(chunk(b"IEND", b""))
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: snap2img.py <capture.txt> <output.ppm|output.png>")
+
+    with open(sys.argv[1], errors="replace") as f:
+        width, height, rows = read_snapshot(f)
+
+    if sys.argv[2].lower().endswith(".png"):
+        write_png(sys.argv[2], width, height, rows)
+    else:
+        write_ppm(sys.argv[2], width, height, rows)
+
+
+if __name__ == "__main__":
+    main()